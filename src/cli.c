@@ -0,0 +1,244 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "codegen.h"
+#include "compiler_util.h"
+#include "source.h"
+#include "wenyan.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <windows.h>
+
+__attribute__((constructor))
+void utf8_init(void) {
+    _setmode(0, _O_BINARY);
+    _setmode(1, _O_BINARY);
+    SetConsoleCP(CP_UTF8);
+    SetConsoleOutputCP(CP_UTF8);
+}
+#else
+utf8_init(void) {
+}
+#endif
+
+// Options, read only once compiling starts
+static WenyanOptions options;
+// Follows output file extension if -1
+static int emitBitcode = -1;
+static bool runMode = false;
+
+/** Start of file name in path */
+static char* fileNameOf(char* path) {
+    char* name = strrchr(path, '/');
+    if (name == NULL) {
+        name = strrchr(path, '\\');
+    }
+    return name == NULL ? path : name + 1;
+}
+
+/**
+ * Parse and generate the module of current context, then write or run it
+ * @return 0 or exit code of generated main with --run, 2 if failed
+ */
+static int compileModule(CompilerContext* ctx, FILE* out) {
+    if (compilerContext_compile(ctx))
+        return 2;
+    printf("\nTotal lines: %d\n", yyget_lineno(ctx->scanner));
+
+    // Execute in this process, exit with return value of generated main
+    int exitCode = 0;
+    if (runMode) {
+        fflush(stdout);
+        if (codegen_run(&exitCode))
+            return 2;
+    } else {
+        // Written through a buffer drained into the file as it fills
+        ByteBuffer output = byteBufferInit();
+        const bool failed = codegen_write(&output, out, ctx->options.emitBitcode);
+        byteBufferFree(&output, false);
+        if (failed)
+            return 2;
+    }
+    return exitCode;
+}
+
+/**
+ * Compile one input with its own CompilerContext on this thread
+ * @param inputPath NULL to read stdin
+ * @param outputPath NULL to write stdout, not used with --run
+ * @return 0 or exit code of generated main with --run, 1 if file cannot be opened, 2 if failed
+ */
+static int compileFile(char* inputPath, const char* outputPath) {
+    FILE* in = inputPath ? fopen(inputPath, "rb") : stdin;
+    if (!in) {
+        fprintf(stderr, "file `%s` doesn't exists or cannot be opened\n", inputPath);
+        return 1;
+    }
+    FILE* out = runMode ? NULL : outputPath ? fopen(outputPath, emitBitcode ? "wb" : "w") : stdout;
+    if (!runMode && !out) {
+        fprintf(stderr, "file `%s` doesn't exists or cannot be opened\n", outputPath);
+        if (in != stdin) fclose(in);
+        return 1;
+    }
+
+    CompilerContext ctx;
+    int exitCode = 2;
+    if (compilerContext_init(&ctx, &options))
+        fprintf(stderr, "cannot create scanner\n");
+    else {
+        ctx.trace = true;
+        ctx.inputFilePath = inputPath;
+        yyset_in(in, ctx.scanner);
+        if (inputPath) {
+            ctx.inputFileName = fileNameOf(inputPath);
+
+            // Scan mapped file in place, otherwise flex reads input file in chunks
+            size_t sourceSize;
+            char* source = sourceMap(in, &sourceSize);
+            if (source)
+                yyScanSource(ctx.scanner, source, sourceSize);
+        }
+        exitCode = compileModule(&ctx, out);
+    }
+
+    compilerContext_free(&ctx);
+    if (in != stdin) fclose(in);
+    if (out && out != stdout) fclose(out);
+    return exitCode;
+}
+
+/** Inputs of --jobs, taken in order by worker threads */
+typedef struct {
+    char** inputs;
+    int count;
+    atomic_int next;
+    // Result of compileFile for each input
+    int* results;
+} BatchQueue;
+
+/** a.wy is written to a.ll, or a.bc with --emit=bc */
+static char* batchOutputPath(char* inputPath) {
+    const char* ext = strrchr(fileNameOf(inputPath), '.');
+    const size_t stemLen = ext ? (size_t)(ext - inputPath) : strlen(inputPath);
+    char* outputPath = malloc(stemLen + 4);
+    memcpy(outputPath, inputPath, stemLen);
+    memcpy(outputPath + stemLen, emitBitcode ? ".bc" : ".ll", 4);
+    return outputPath;
+}
+
+static void* batchWorker(void* arg) {
+    BatchQueue* queue = arg;
+    int index;
+    while ((index = atomic_fetch_add(&queue->next, 1)) < queue->count) {
+        char* outputPath = batchOutputPath(queue->inputs[index]);
+        queue->results[index] = compileFile(queue->inputs[index], outputPath);
+        free(outputPath);
+    }
+    return NULL;
+}
+
+/**
+ * Compile every input on up to jobs threads
+ * @return largest result of compileFile
+ */
+static int compileBatch(char** inputs, const int count, int jobs) {
+    BatchQueue queue = {inputs, count, 0, calloc(count, sizeof(int))};
+    if (jobs > count)
+        jobs = count;
+
+    // Calling thread is one of the jobs
+    pthread_t* threads = malloc(jobs * sizeof(pthread_t));
+    int started = 0;
+    while (started < jobs - 1 && !pthread_create(&threads[started], NULL, batchWorker, &queue))
+        ++started;
+    batchWorker(&queue);
+    for (int i = 0; i < started; ++i)
+        pthread_join(threads[i], NULL);
+
+    int exitCode = 0;
+    for (int i = 0; i < count; ++i) {
+        if (queue.results[i] > exitCode)
+            exitCode = queue.results[i];
+    }
+    free(threads);
+    free(queue.results);
+    return exitCode;
+}
+
+int main(int argc, char* argv[]) {
+    utf8_init();
+
+    // Parse options, positional arguments are moved to the front of argv
+    char** args = argv + 1;
+    int argsCount = 0;
+    int jobs = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--buffer=line") == 0)
+            options.lineBuffered = true;
+        else if (strcmp(argv[i], "--buffer=full") == 0)
+            options.lineBuffered = false;
+        else if (strcmp(argv[i], "--emit=ll") == 0)
+            emitBitcode = false;
+        else if (strcmp(argv[i], "--emit=bc") == 0)
+            emitBitcode = true;
+        else if (strcmp(argv[i], "--run") == 0)
+            runMode = true;
+        else if (strcmp(argv[i], "--loop-hints") == 0)
+            options.loopHints = true;
+        else if (strcmp(argv[i], "--merge-strings") == 0)
+            options.mergeStrings = true;
+        else if (strcmp(argv[i], "--stream") == 0)
+            options.stream = true;
+        else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc && (jobs = atoi(argv[i + 1])) > 0)
+            ++i;
+        else if (argv[i][0] == '-' && argv[i][1] == 'O' && argv[i][2] >= '0' && argv[i][2] <= '3' && !argv[i][3])
+            options.optLevel = argv[i][2] - '0';
+        else if (argv[i][0] == '-')
+            argsCount = -1;
+        else if (argsCount >= 0)
+            args[argsCount++] = argv[i];
+    }
+
+    // Batch mode, every positional argument is an input file
+    if (jobs > 0 && argsCount > 0) {
+        if (runMode) {
+            fprintf(stderr, "--run does not take --jobs\n");
+            return 1;
+        }
+        if (emitBitcode == -1)
+            emitBitcode = false;
+        options.emitBitcode = emitBitcode;
+        return compileBatch(args, argsCount, jobs);
+    }
+    if (jobs > 0 || argsCount > 2)
+        argsCount = -1;
+
+    // Output format follows output file extension if not specified
+    char* outputFilePath = argsCount == 2 ? args[1] : NULL;
+    if (emitBitcode == -1) {
+        const char* ext = outputFilePath ? strrchr(outputFilePath, '.') : NULL;
+        emitBitcode = ext && strcmp(ext, ".bc") == 0;
+    }
+    options.emitBitcode = emitBitcode;
+
+    if (runMode && argsCount == 2) {
+        fprintf(stderr, "--run does not take output file\n");
+        return 1;
+    }
+    if (argsCount == 0) {
+        printf("===== Use stdin for parsing =====");
+    } else if (argsCount < 0) {
+        fprintf(stderr, "Usage: %s [-O0|-O1|-O2|-O3] [--loop-hints] [--merge-strings] [--stream] [--buffer=line|full] [--emit=ll|bc] [input file] [output file]\n"
+                "       %s [-O0|-O1|-O2|-O3] [--loop-hints] [--merge-strings] [--stream] [--buffer=line|full] --run [input file]\n"
+                "       %s [-O0|-O1|-O2|-O3] [--loop-hints] [--merge-strings] [--stream] [--buffer=line|full] [--emit=ll|bc] --jobs N input file...\n",
+                argv[0], argv[0], argv[0]);
+        return 1;
+    }
+
+    return compileFile(argsCount ? args[0] : NULL, outputFilePath);
+}
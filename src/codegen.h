@@ -0,0 +1,79 @@
+#ifndef WENYAN_LLVM_CODEGEN_H
+#define WENYAN_LLVM_CODEGEN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "object.h"
+#include "lib/byte_buffer.h"
+
+// Loop output up to this size is written from one precomputed constant, larger output is written by a loop
+#define CODEGEN_CONST_OUTPUT_LIMIT 4096
+
+/*
+ * Code generation backend used by the code_* entry points in main.c.
+ * codegen_text.c writes textual IR into byte buffers, codegen_llvm.c builds the module
+ * with LLVM C API when compiled with WENYAN_USE_LLVM.
+ * Objects passed in are already type checked, number operands are literal, variable or expression result.
+ * Options are read from compilerContext->options.
+ */
+
+/**
+ * Start a new module with runtime and empty main function
+ * @param moduleName source file name, NULL if read from stdin
+ * @return true if failed
+ */
+bool codegen_moduleBegin(const char* moduleName);
+/**
+ * Finish main function
+ * @return true if failed
+ */
+bool codegen_moduleEnd();
+/**
+ * Run LLVM optimization pipeline on the finished module
+ * @param optLevel 0 to 3, same as -O of clang
+ * @return true if failed
+ */
+bool codegen_optimize(int optLevel);
+/**
+ * Write the finished module
+ * @param out buffer the module is appended to
+ * @param file output file out is drained into while writing, NULL to keep the whole module in out
+ * @param bitcode write LLVM bitcode instead of textual IR
+ * @return true if failed
+ */
+bool codegen_write(ByteBuffer* out, FILE* file, bool bitcode);
+/**
+ * Compile the finished module with JIT and call its main function
+ * @param exitCode return value of main
+ * @return true if failed
+ */
+bool codegen_run(int* exitCode);
+void codegen_free();
+
+void codegen_printNumber(const Object* value, bool newLine);
+void codegen_printStr(const char* str, bool newLine);
+void codegen_flush();
+
+void codegen_createVariable(const SymbolData* symbol, const Object* value);
+void codegen_storeVariable(const SymbolData* symbol, const Object* value);
+void codegen_endVariable(const SymbolData* symbol);
+
+/**
+ * Compute lhs op rhs
+ * @return index of the result, used as SymbolData.index of expression cache
+ */
+int32_t codegen_arithmetic(char op, ObjectType type, const Object* lhs, const Object* rhs);
+
+void codegen_forLoop(int32_t loopIndex, ObjectType type, const Object* count);
+void codegen_forLoopEnd(int32_t loopIndex, ObjectType type);
+/**
+ * End the loop by replacing everything generated since codegen_forLoop with writing its output directly,
+ * used when the loop body only writes constant bytes
+ * @param output bytes written by one iteration
+ * @param count loop count
+ */
+void codegen_forLoopConstant(int32_t loopIndex, const uint8_t* output, size_t size, int64_t count);
+
+#endif //WENYAN_LLVM_CODEGEN_H
@@ -0,0 +1,558 @@
+#include "codegen.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <llvm-c/Analysis.h>
+#include <llvm-c/BitWriter.h>
+#include <llvm-c/Core.h>
+#include <llvm-c/DebugInfo.h>
+#include <llvm-c/IRReader.h>
+#include <llvm-c/LLJIT.h>
+#include <llvm-c/Orc.h>
+#include <llvm-c/Target.h>
+#include <llvm-c/TargetMachine.h>
+#include <llvm-c/Transforms/PassBuilder.h>
+#include <llvm/Config/llvm-config.h>
+
+#include "compiler_util.h"
+#include "const_pool.h"
+#include "lib/byte_buffer.h"
+#include "runtime.h"
+
+#include "WJCL/list/wjcl_linked_list.h"
+
+typedef struct {
+    // Block and last global before the loop, everything after them is dropped if loop is replaced by its output
+    LLVMBasicBlockRef before;
+    LLVMValueRef lastGlobal;
+    int32_t constStrCount;
+    LLVMBasicBlockRef entry;
+    LLVMBasicBlockRef header;
+    LLVMBasicBlockRef exit;
+    LLVMValueRef i;
+} LoopBlocks;
+
+struct CodegenState {
+    LLVMOrcThreadSafeContextRef threadSafeContext;
+    LLVMContextRef context;
+    LLVMModuleRef module;
+    LLVMBuilderRef builder;
+    LLVMBuilderRef allocaBuilder;
+    LLVMBasicBlockRef allocaBlock;
+
+    /** LLVMValueRef[], stack slot of variable, indexed by SymbolData.index */
+    ByteBuffer variableSlots;
+    /** LLVMValueRef[], expression result, indexed by SymbolData.index of expression cache */
+    ByteBuffer cacheValues;
+    ConstPool strPool;
+    /** LLVMValueRef[], global of each string constant, indexed by entry of strPool */
+    ByteBuffer strGlobals;
+    /** LinkedList<@link LoopBlocks> */
+    LinkedList loopBlockList;
+};
+
+// Target registry is process wide, modules compiled on other threads share it
+static pthread_once_t nativeTargetOnce = PTHREAD_ONCE_INIT;
+
+#define valueAt(buff, index) (((LLVMValueRef*)(buff).buf)[index])
+
+static LLVMTypeRef getLLVMType(const ObjectType type) {
+    CodegenState* cg = compilerContext->codegen;
+    switch (type) {
+    case OBJECT_TYPE_I32: return LLVMInt32TypeInContext(cg->context);
+    case OBJECT_TYPE_I64: return LLVMInt64TypeInContext(cg->context);
+    case OBJECT_TYPE_F64: return LLVMDoubleTypeInContext(cg->context);
+    default: return NULL;
+    }
+}
+
+static LLVMValueRef callRuntime(const char* name, LLVMValueRef* args, const unsigned argCount) {
+    CodegenState* cg = compilerContext->codegen;
+    LLVMValueRef function = LLVMGetNamedFunction(cg->module, name);
+    return LLVMBuildCall2(cg->builder, LLVMGlobalGetValueType(function), function, args, argCount, "");
+}
+
+/**
+ * Get the LLVM value of a number object.
+ * Literal is a constant, variable is loaded from its stack slot,
+ * and expression result is already a value.
+ */
+static LLVMValueRef codegen_loadValue(const Object* obj) {
+    CodegenState* cg = compilerContext->codegen;
+    if (obj->type != OBJECT_TYPE_IDENT) {
+        LLVMTypeRef type = getLLVMType(obj->type);
+        char* num = sciToStr(&obj->number);
+        LLVMValueRef value = obj->type == OBJECT_TYPE_F64
+                                 ? LLVMConstRealOfString(type, num)
+                                 : LLVMConstIntOfString(type, num, 10);
+        free(num);
+        return value;
+    }
+
+    const SymbolData* symbol = obj->symbol;
+    if (symbol->expCache)
+        return valueAt(cg->cacheValues, symbol->index);
+
+    return LLVMBuildLoad2(cg->builder, getLLVMType(symbol->type), valueAt(cg->variableSlots, symbol->index), "");
+}
+
+static LLVMMetadataRef metadataNode(const char* name, LLVMValueRef value) {
+    CodegenState* cg = compilerContext->codegen;
+    LLVMMetadataRef operands[] = {LLVMMDStringInContext2(cg->context, name, strlen(name)), NULL};
+    if (value) operands[1] = LLVMValueAsMetadata(value);
+    return LLVMMDNodeInContext2(cg->context, operands, value ? 2 : 1);
+}
+
+/**
+ * Attach llvm.loop metadata to loop latch branch
+ */
+static void setLoopMetadata(LLVMValueRef latch) {
+    CodegenState* cg = compilerContext->codegen;
+    // First operand refers to the loop id itself
+    LLVMMetadataRef self = LLVMTemporaryMDNode(cg->context, NULL, 0);
+    LLVMMetadataRef operands[4] = {self, metadataNode("llvm.loop.mustprogress", NULL)};
+    size_t operandCount = 2;
+    if (compilerContext->options.loopHints) {
+        operands[operandCount++] = metadataNode("llvm.loop.unroll.enable", NULL);
+        operands[operandCount++] = metadataNode("llvm.loop.vectorize.enable",
+                                                LLVMConstInt(LLVMInt1TypeInContext(cg->context), 1, false));
+    }
+    LLVMMetadataRef loopId = LLVMMDNodeInContext2(cg->context, operands, operandCount);
+    LLVMMetadataReplaceAllUsesWith(self, loopId);
+    LLVMSetMetadata(latch, LLVMGetMDKindIDInContext(cg->context, "llvm.loop", strlen("llvm.loop")),
+                    LLVMMetadataAsValue(cg->context, loopId));
+}
+
+static void callLifetime(const char* name, const SymbolData* symbol) {
+    CodegenState* cg = compilerContext->codegen;
+    LLVMValueRef args[] = {
+        LLVMConstInt(LLVMInt64TypeInContext(cg->context), objectType2llvmSize[symbol->type], false),
+        valueAt(cg->variableSlots, symbol->index),
+    };
+    callRuntime(name, args, 2);
+}
+
+static bool printLLVMError(const char* prefix, LLVMErrorRef error) {
+    char* message = LLVMGetErrorMessage(error);
+    reportFailuref("%s: %s\n", prefix, message);
+    LLVMDisposeErrorMessage(message);
+    return true;
+}
+
+static void initNativeTarget() {
+    LLVMInitializeNativeTarget();
+    LLVMInitializeNativeAsmPrinter();
+}
+
+bool codegen_moduleBegin(const char* moduleName) {
+    CodegenState* cg = compilerContext->codegen = malloc(sizeof(CodegenState));
+    *cg = (CodegenState){
+        .variableSlots = byteBufferInit(),
+        .cacheValues = byteBufferInit(),
+        .strPool = constPoolInit(),
+        .strGlobals = byteBufferInit(),
+        .loopBlockList = linkedList_create(),
+    };
+    linkedList_init(&cg->loopBlockList);
+
+    // Context is owned by thread safe context, so the module can be handed to JIT without copy
+#if LLVM_VERSION_MAJOR >= 21
+    cg->context = LLVMContextCreate();
+    cg->threadSafeContext = LLVMOrcCreateNewThreadSafeContextFromLLVMContext(cg->context);
+#else
+    cg->threadSafeContext = LLVMOrcCreateNewThreadSafeContext();
+    cg->context = LLVMOrcThreadSafeContextGetContext(cg->threadSafeContext);
+#endif
+
+    // Runtime is parsed as the base of the module, main function is added after it
+    LLVMMemoryBufferRef runtimeBuffer = LLVMCreateMemoryBufferWithMemoryRangeCopy(
+        runtimeSource, strlen(runtimeSource), "runtime");
+    char* message = NULL;
+    if (LLVMParseIRInContext(cg->context, runtimeBuffer, &cg->module, &message)) {
+        reportFailuref("runtime module invalid: %s\n", message);
+        LLVMDisposeMessage(message);
+        cg->module = NULL;
+        return true;
+    }
+    if (moduleName) {
+        LLVMSetModuleIdentifier(cg->module, moduleName, strlen(moduleName));
+        LLVMSetSourceFileName(cg->module, moduleName, strlen(moduleName));
+    }
+
+    LLVMTypeRef mainType = LLVMFunctionType(LLVMInt32TypeInContext(cg->context), NULL, 0, false);
+    LLVMValueRef mainFunction = LLVMAddFunction(cg->module, "main", mainType);
+    const unsigned mustProgress = LLVMGetEnumAttributeKindForName("mustprogress", strlen("mustprogress"));
+    LLVMAddAttributeAtIndex(mainFunction, LLVMAttributeFunctionIndex,
+                            LLVMCreateEnumAttribute(cg->context, mustProgress, 0));
+
+    // Stack slots are allocated in entry block, so loop body won't grow the stack
+    cg->allocaBlock = LLVMAppendBasicBlockInContext(cg->context, mainFunction, "entry");
+    cg->allocaBuilder = LLVMCreateBuilderInContext(cg->context);
+    LLVMPositionBuilderAtEnd(cg->allocaBuilder, cg->allocaBlock);
+
+    cg->builder = LLVMCreateBuilderInContext(cg->context);
+    LLVMPositionBuilderAtEnd(cg->builder, LLVMAppendBasicBlockInContext(cg->context, mainFunction, "body"));
+    callRuntime("wy_init", NULL, 0);
+    return false;
+}
+
+bool codegen_moduleEnd() {
+    CodegenState* cg = compilerContext->codegen;
+    callRuntime("wy_flush", NULL, 0);
+    LLVMBuildRet(cg->builder, LLVMConstInt(LLVMInt32TypeInContext(cg->context), 0, false));
+    LLVMBuildBr(cg->allocaBuilder, LLVMGetNextBasicBlock(cg->allocaBlock));
+
+    if (compilerContext->options.mergeStrings) {
+        // Point uses of a tail string into its host and drop the tail global
+        constPool_mergeSuffixes(&cg->strPool);
+        LLVMTypeRef i8Type = LLVMInt8TypeInContext(cg->context);
+        for (int32_t i = 0; i < cg->strPool.count; ++i) {
+            const ConstPoolEntry* entry = constPoolEntry(&cg->strPool, i);
+            if (entry->host < 0) continue;
+            LLVMValueRef offset = LLVMConstInt(LLVMInt64TypeInContext(cg->context),
+                                               constPoolEntry(&cg->strPool, entry->host)->len - entry->len, false);
+            LLVMValueRef tail = LLVMConstInBoundsGEP2(i8Type, valueAt(cg->strGlobals, entry->host), &offset, 1);
+            LLVMReplaceAllUsesWith(valueAt(cg->strGlobals, i), tail);
+            LLVMDeleteGlobal(valueAt(cg->strGlobals, i));
+            valueAt(cg->strGlobals, i) = tail;
+        }
+    }
+
+    char* message = NULL;
+    if (LLVMVerifyModule(cg->module, LLVMReturnStatusAction, &message)) {
+        reportFailuref("generated module invalid: %s\n", message);
+        LLVMDisposeMessage(message);
+        return true;
+    }
+    LLVMDisposeMessage(message);
+    return false;
+}
+
+bool codegen_optimize(int optLevel) {
+    if (optLevel == 0)
+        return false;
+    CodegenState* cg = compilerContext->codegen;
+
+    // Target machine for data layout and cost model, generic cpu so the output still runs on other machine
+    pthread_once(&nativeTargetOnce, initNativeTarget);
+    char* triple = LLVMGetDefaultTargetTriple();
+    LLVMTargetRef target;
+    char* message = NULL;
+    if (LLVMGetTargetFromTriple(triple, &target, &message)) {
+        reportFailuref("target '%s' not available: %s\n", triple, message);
+        LLVMDisposeMessage(message);
+        LLVMDisposeMessage(triple);
+        return true;
+    }
+    LLVMTargetMachineRef machine = LLVMCreateTargetMachine(
+        target, triple, "", "", (LLVMCodeGenOptLevel)optLevel, LLVMRelocPIC, LLVMCodeModelDefault);
+    LLVMTargetDataRef dataLayout = LLVMCreateTargetDataLayout(machine);
+    LLVMSetTarget(cg->module, triple);
+    LLVMSetModuleDataLayout(cg->module, dataLayout);
+    LLVMDisposeTargetData(dataLayout);
+    LLVMDisposeMessage(triple);
+
+    char passes[16];
+    snprintf(passes, sizeof(passes), "default<O%d>", optLevel);
+    LLVMPassBuilderOptionsRef options = LLVMCreatePassBuilderOptions();
+    LLVMErrorRef error = LLVMRunPasses(cg->module, passes, machine, options);
+    LLVMDisposePassBuilderOptions(options);
+    LLVMDisposeTargetMachine(machine);
+
+    if (error)
+        return printLLVMError("optimization failed", error);
+    return false;
+}
+
+bool codegen_write(ByteBuffer* out, FILE* file, bool bitcode) {
+    CodegenState* cg = compilerContext->codegen;
+    // Module is printed whole by LLVM, written to file without copying into out
+    if (file && out->len) {
+        byteBufferWriteToFile(out, file);
+        out->len = 0;
+    }
+    if (bitcode) {
+        LLVMMemoryBufferRef buffer = LLVMWriteBitcodeToMemoryBuffer(cg->module);
+        if (file)
+            fwrite(LLVMGetBufferStart(buffer), 1, LLVMGetBufferSize(buffer), file);
+        else
+            byteBufferWrite(out, (uint8_t*)LLVMGetBufferStart(buffer), LLVMGetBufferSize(buffer));
+        LLVMDisposeMemoryBuffer(buffer);
+    } else {
+        char* ir = LLVMPrintModuleToString(cg->module);
+        if (file)
+            fputs(ir, file);
+        else
+            byteBufferWriteStr(out, ir);
+        LLVMDisposeMessage(ir);
+    }
+    return false;
+}
+
+bool codegen_run(int* exitCode) {
+    CodegenState* cg = compilerContext->codegen;
+    pthread_once(&nativeTargetOnce, initNativeTarget);
+
+    LLVMOrcLLJITRef jit;
+    LLVMErrorRef error = LLVMOrcCreateLLJIT(&jit, NULL);
+    if (error)
+        return printLLVMError("create JIT failed", error);
+    LLVMOrcJITDylibRef mainDylib = LLVMOrcLLJITGetMainJITDylib(jit);
+
+    // Library functions used by runtime are resolved from this process
+    LLVMOrcDefinitionGeneratorRef generator;
+    error = LLVMOrcCreateDynamicLibrarySearchGeneratorForProcess(
+        &generator, LLVMOrcLLJITGetGlobalPrefix(jit), NULL, NULL);
+    if (!error) {
+        LLVMOrcJITDylibAddGenerator(mainDylib, generator);
+
+        LLVMOrcThreadSafeModuleRef threadSafeModule = LLVMOrcCreateNewThreadSafeModule(cg->module, cg->threadSafeContext);
+        cg->module = NULL;
+        error = LLVMOrcLLJITAddLLVMIRModule(jit, mainDylib, threadSafeModule);
+        if (error)
+            LLVMOrcDisposeThreadSafeModule(threadSafeModule);
+    }
+
+    LLVMOrcExecutorAddress mainAddress;
+    if (!error)
+        error = LLVMOrcLLJITLookup(jit, &mainAddress, "main");
+    if (error) {
+        printLLVMError("JIT failed", error);
+        LLVMOrcDisposeLLJIT(jit);
+        return true;
+    }
+
+    int (*mainFunction)() = (int (*)())mainAddress;
+    *exitCode = mainFunction();
+
+    error = LLVMOrcDisposeLLJIT(jit);
+    if (error)
+        return printLLVMError("dispose JIT failed", error);
+    return false;
+}
+
+void codegen_free() {
+    CodegenState* cg = compilerContext->codegen;
+    if (!cg) return;
+    linkedList_free(&cg->loopBlockList);
+    byteBufferFree(&cg->variableSlots, false);
+    byteBufferFree(&cg->cacheValues, false);
+    byteBufferFree(&cg->strGlobals, false);
+    constPool_free(&cg->strPool);
+    if (cg->builder) LLVMDisposeBuilder(cg->builder);
+    if (cg->allocaBuilder) LLVMDisposeBuilder(cg->allocaBuilder);
+    if (cg->module) LLVMDisposeModule(cg->module);
+    if (cg->threadSafeContext) LLVMOrcDisposeThreadSafeContext(cg->threadSafeContext);
+    free(cg);
+    compilerContext->codegen = NULL;
+}
+
+void codegen_printNumber(const Object* value, bool newLine) {
+    CodegenState* cg = compilerContext->codegen;
+    char name[16];
+    snprintf(name, sizeof(name), "wy_print_%s", objectType2llvmType[getObjectType(value)]);
+    LLVMValueRef args[] = {
+        codegen_loadValue(value),
+        LLVMConstInt(LLVMInt1TypeInContext(cg->context), newLine, false),
+    };
+    callRuntime(name, args, 2);
+}
+
+/**
+ * Get global of string constant, same bytes share one global
+ * @param newLine append '\n' after str
+ */
+static LLVMValueRef codegen_constStr(const char* str, const size_t len, const bool newLine) {
+    CodegenState* cg = compilerContext->codegen;
+    bool created;
+    const int32_t index = constPool_add(&cg->strPool, str, len, newLine, &created);
+    if (!created)
+        return valueAt(cg->strGlobals, index);
+
+    const ConstPoolEntry* entry = constPoolEntry(&cg->strPool, index);
+    LLVMValueRef init = LLVMConstStringInContext(cg->context, constPoolBytes(&cg->strPool, entry), entry->len, true);
+    LLVMValueRef global = LLVMAddGlobal(cg->module, LLVMTypeOf(init), "str");
+    LLVMSetInitializer(global, init);
+    LLVMSetGlobalConstant(global, true);
+    LLVMSetLinkage(global, LLVMPrivateLinkage);
+    LLVMSetUnnamedAddress(global, LLVMGlobalUnnamedAddr);
+    byteBufferWrite(&cg->strGlobals, (uint8_t*)&global, sizeof(LLVMValueRef));
+    return global;
+}
+
+static void callWrite(LLVMValueRef data, const size_t size) {
+    CodegenState* cg = compilerContext->codegen;
+    LLVMValueRef args[] = {data, LLVMConstInt(LLVMInt64TypeInContext(cg->context), size, false)};
+    callRuntime("wy_write", args, 2);
+}
+
+void codegen_printStr(const char* str, bool newLine) {
+    const size_t len = strlen(str);
+    callWrite(codegen_constStr(str, len, newLine), len + newLine);
+}
+
+void codegen_flush() {
+    callRuntime("wy_flush", NULL, 0);
+}
+
+void codegen_createVariable(const SymbolData* symbol, const Object* value) {
+    CodegenState* cg = compilerContext->codegen;
+    LLVMValueRef slot = LLVMBuildAlloca(cg->allocaBuilder, getLLVMType(symbol->type), "var");
+    // Symbol index is assigned in creation order
+    byteBufferWrite(&cg->variableSlots, (uint8_t*)&slot, sizeof(LLVMValueRef));
+
+    callLifetime("llvm.lifetime.start.p0", symbol);
+    LLVMBuildStore(cg->builder, codegen_loadValue(value), slot);
+}
+
+void codegen_storeVariable(const SymbolData* symbol, const Object* value) {
+    CodegenState* cg = compilerContext->codegen;
+    LLVMBuildStore(cg->builder, codegen_loadValue(value), valueAt(cg->variableSlots, symbol->index));
+}
+
+void codegen_endVariable(const SymbolData* symbol) {
+    // End variables lifetime, let LLVM reuse the stack slot in sibling scope
+    callLifetime("llvm.lifetime.end.p0", symbol);
+}
+
+int32_t codegen_arithmetic(char op, ObjectType type, const Object* lhs, const Object* rhs) {
+    CodegenState* cg = compilerContext->codegen;
+    LLVMValueRef lhsValue = codegen_loadValue(lhs), rhsValue = codegen_loadValue(rhs);
+    const bool isFloat = type == OBJECT_TYPE_F64;
+
+    LLVMValueRef result;
+    switch (op) {
+    case '+':
+        result = isFloat ? LLVMBuildFAdd(cg->builder, lhsValue, rhsValue, "t") : LLVMBuildNSWAdd(cg->builder, lhsValue, rhsValue, "t");
+        break;
+    case '-':
+        result = isFloat ? LLVMBuildFSub(cg->builder, lhsValue, rhsValue, "t") : LLVMBuildNSWSub(cg->builder, lhsValue, rhsValue, "t");
+        break;
+    case '*':
+        result = isFloat ? LLVMBuildFMul(cg->builder, lhsValue, rhsValue, "t") : LLVMBuildNSWMul(cg->builder, lhsValue, rhsValue, "t");
+        break;
+    default:
+        result = isFloat ? LLVMBuildFDiv(cg->builder, lhsValue, rhsValue, "t") : LLVMBuildSDiv(cg->builder, lhsValue, rhsValue, "t");
+        break;
+    }
+
+    byteBufferWrite(&cg->cacheValues, (uint8_t*)&result, sizeof(LLVMValueRef));
+    return (int32_t)(cg->cacheValues.len / sizeof(LLVMValueRef) - 1);
+}
+
+void codegen_forLoop(int32_t loopIndex, ObjectType type, const Object* count) {
+    CodegenState* cg = compilerContext->codegen;
+    LLVMValueRef function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(cg->builder));
+    LoopBlocks* loop = malloc(sizeof(LoopBlocks));
+    loop->before = LLVMGetInsertBlock(cg->builder);
+    loop->lastGlobal = LLVMGetLastGlobal(cg->module);
+    loop->constStrCount = cg->strPool.count;
+    loop->entry = LLVMAppendBasicBlockInContext(cg->context, function, "loop.entry");
+    loop->header = LLVMAppendBasicBlockInContext(cg->context, function, "loop.header");
+    LLVMBasicBlockRef body = LLVMAppendBasicBlockInContext(cg->context, function, "loop.body");
+    // Exit block is appended after the loop body is finished
+    loop->exit = LLVMCreateBasicBlockInContext(cg->context, "loop.exit");
+    linkedList_addp(&cg->loopBlockList, true, loop);
+
+    LLVMBuildBr(cg->builder, loop->entry);
+    LLVMPositionBuilderAtEnd(cg->builder, loop->entry);
+    // Get loop count
+    LLVMValueRef countValue = codegen_loadValue(count);
+    LLVMBuildBr(cg->builder, loop->header);
+
+    LLVMPositionBuilderAtEnd(cg->builder, loop->header);
+    LLVMTypeRef llvmType = getLLVMType(type);
+    loop->i = LLVMBuildPhi(cg->builder, llvmType, "loop.i");
+    LLVMValueRef zero = LLVMConstInt(llvmType, 0, false);
+    LLVMAddIncoming(loop->i, &zero, &loop->entry, 1);
+    LLVMValueRef cond = LLVMBuildICmp(cg->builder, LLVMIntSLT, loop->i, countValue, "loop.cond");
+    LLVMBuildCondBr(cg->builder, cond, body, loop->exit);
+
+    LLVMPositionBuilderAtEnd(cg->builder, body);
+}
+
+void codegen_forLoopEnd(int32_t loopIndex, ObjectType type) {
+    CodegenState* cg = compilerContext->codegen;
+    LoopBlocks* loop = cg->loopBlockList.head->prev->value;
+    LLVMValueRef function = LLVMGetBasicBlockParent(loop->header);
+
+    LLVMBasicBlockRef update = LLVMAppendBasicBlockInContext(cg->context, function, "loop.update");
+    LLVMBuildBr(cg->builder, update);
+
+    LLVMPositionBuilderAtEnd(cg->builder, update);
+    LLVMValueRef one = LLVMConstInt(getLLVMType(type), 1, false);
+    LLVMValueRef next = LLVMBuildNSWAdd(cg->builder, loop->i, one, "loop.i.next");
+    LLVMAddIncoming(loop->i, &next, &update, 1);
+    setLoopMetadata(LLVMBuildBr(cg->builder, loop->header));
+
+    LLVMAppendExistingBasicBlock(function, loop->exit);
+    LLVMPositionBuilderAtEnd(cg->builder, loop->exit);
+    linkedList_deleteNode(&cg->loopBlockList, cg->loopBlockList.head->prev);
+}
+
+void codegen_forLoopConstant(int32_t loopIndex, const uint8_t* output, size_t size, int64_t count) {
+    CodegenState* cg = compilerContext->codegen;
+    LoopBlocks* loop = cg->loopBlockList.head->prev->value;
+    LLVMValueRef function = LLVMGetBasicBlockParent(loop->before);
+
+    // Drop the loop, all blocks after it and string constants created by its body
+    LLVMAppendExistingBasicBlock(function, loop->exit);
+    LLVMInstructionEraseFromParent(LLVMGetBasicBlockTerminator(loop->before));
+    for (LLVMBasicBlockRef block = LLVMGetNextBasicBlock(loop->before); block; block = LLVMGetNextBasicBlock(block)) {
+        LLVMValueRef instr;
+        while ((instr = LLVMGetLastInstruction(block))) {
+            if (LLVMGetFirstUse(instr))
+                LLVMReplaceAllUsesWith(instr, LLVMGetUndef(LLVMTypeOf(instr)));
+            LLVMInstructionEraseFromParent(instr);
+        }
+    }
+    LLVMBasicBlockRef block;
+    while ((block = LLVMGetNextBasicBlock(loop->before)))
+        LLVMDeleteBasicBlock(block);
+    LLVMValueRef global = loop->lastGlobal ? LLVMGetNextGlobal(loop->lastGlobal) : LLVMGetFirstGlobal(cg->module);
+    while (global) {
+        LLVMValueRef next = LLVMGetNextGlobal(global);
+        LLVMDeleteGlobal(global);
+        global = next;
+    }
+    constPool_truncate(&cg->strPool, loop->constStrCount);
+    cg->strGlobals.len = loop->constStrCount * sizeof(LLVMValueRef);
+
+    LLVMBasicBlockRef before = loop->before;
+    LLVMPositionBuilderAtEnd(cg->builder, before);
+    linkedList_deleteNode(&cg->loopBlockList, cg->loopBlockList.head->prev);
+    if (size == 0 || count == 0)
+        return;
+
+    // Small output is repeated into one constant
+    if ((uint64_t)count <= CODEGEN_CONST_OUTPUT_LIMIT / size) {
+        const size_t totalSize = size * count;
+        char* data = malloc(totalSize);
+        for (int64_t i = 0; i < count; ++i)
+            memcpy(data + i * size, output, size);
+        callWrite(codegen_constStr(data, totalSize, false), totalSize);
+        free(data);
+        return;
+    }
+
+    // Large output writes one iteration per loop
+    LLVMValueRef str = codegen_constStr((const char*)output, size, false);
+    LLVMTypeRef i64Type = LLVMInt64TypeInContext(cg->context);
+    LLVMBasicBlockRef header = LLVMAppendBasicBlockInContext(cg->context, function, "loop.header");
+    LLVMBasicBlockRef exit = LLVMAppendBasicBlockInContext(cg->context, function, "loop.exit");
+    LLVMBuildBr(cg->builder, header);
+
+    LLVMPositionBuilderAtEnd(cg->builder, header);
+    LLVMValueRef i = LLVMBuildPhi(cg->builder, i64Type, "loop.i");
+    callWrite(str, size);
+    LLVMValueRef next = LLVMBuildNUWAdd(cg->builder, i, LLVMConstInt(i64Type, 1, false), "loop.i.next");
+    LLVMValueRef cond = LLVMBuildICmp(cg->builder, LLVMIntULT, next, LLVMConstInt(i64Type, count, false), "loop.cond");
+    setLoopMetadata(LLVMBuildCondBr(cg->builder, cond, header, exit));
+    LLVMValueRef incoming[] = {LLVMConstInt(i64Type, 0, false), next};
+    LLVMBasicBlockRef incomingBlocks[] = {before, header};
+    LLVMAddIncoming(i, incoming, incomingBlocks, 2);
+
+    LLVMPositionBuilderAtEnd(cg->builder, exit);
+}
@@ -0,0 +1,477 @@
+#include "codegen.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "compiler_util.h"
+#include "const_pool.h"
+#include "lib/byte_buffer.h"
+#include "runtime.h"
+
+#include "WJCL/list/wjcl_linked_list.h"
+
+#define buffPrintln(buff, format, ...) \
+    byteBufferWriteFormat(buff, SCOPE_SPACE_FMT format "\n", SCOPE_SPACE_VAL, ##__VA_ARGS__)
+
+#define OPERAND_BUFFER_LEN 64
+// With --stream, buffers larger than this are moved to their spill file once no loop is open
+#define STREAM_CHUNK_SIZE (1 << 20)
+
+// Lines emitted for every statement are written piece by piece instead of through format parsing
+#define buffWrite(buff, str) byteBufferWrite(buff, (uint8_t*)(str), strlen(str))
+
+static void buffIndent(ByteBuffer* buff) {
+    static const char spaces[] = "                                                                ";
+    byteBufferWrite(buff, (uint8_t*)spaces, SCOPE_SPACE_WIDTH);
+}
+
+typedef struct {
+    size_t mainFunLen;
+    size_t metadataLen;
+    int32_t constStrCount;
+    int metadataCount;
+} LoopCheckpoint;
+
+struct CodegenState {
+    ConstPool strPool;
+    ByteBuffer mainFunBuff;
+    ByteBuffer allocaBuff;
+    ByteBuffer metadataBuff;
+    // Written part of the buffer above, allocas must stay in front of main body so each has its own file
+    FILE* mainFunSpill;
+    FILE* allocaSpill;
+    FILE* metadataSpill;
+    // options.stream of this module, off after a spill file can't be created
+    bool streaming;
+    const char* moduleFileName;
+
+    int variableCacheCount;
+    // Metadata !0 to !2 are loop properties shared by all loops
+    int metadataCount;
+
+    /** LinkedList<@link LoopCheckpoint>, buffer state before each open loop */
+    LinkedList loopCheckpointList;
+};
+
+static bool spillBuffer(ByteBuffer* buff, FILE** spill) {
+    if (buff->len < STREAM_CHUNK_SIZE)
+        return false;
+    if (!*spill && !(*spill = tmpfile())) {
+        reportFailuref("cannot create temporary file for --stream\n");
+        return true;
+    }
+    byteBufferWriteToFile(buff, *spill);
+    buff->len = 0;
+    return false;
+}
+
+/**
+ * Move large buffers to spill files, only between statements outside of loops,
+ * loop checkpoints refer to buffer length and may still roll the loop back
+ */
+static void codegen_spill() {
+    CodegenState* cg = compilerContext->codegen;
+    if (!cg->streaming || cg->loopCheckpointList.head->next != cg->loopCheckpointList.head)
+        return;
+    // Rest of the module stays in memory once a spill file can't be created
+    if (spillBuffer(&cg->mainFunBuff, &cg->mainFunSpill) || spillBuffer(&cg->allocaBuff, &cg->allocaSpill) ||
+        spillBuffer(&cg->metadataBuff, &cg->metadataSpill))
+        cg->streaming = false;
+}
+
+/** Move out to file once it holds limit bytes, without file everything stays in out */
+static void drainOutput(ByteBuffer* out, FILE* file, const size_t limit) {
+    if (!file || !out->len || out->len < limit)
+        return;
+    byteBufferWriteToFile(out, file);
+    out->len = 0;
+}
+
+/** Copy spilled part then rest of the buffer to output, straight to file if there is one */
+static void writeSpilled(ByteBuffer* buff, FILE* spill, ByteBuffer* out, FILE* file) {
+    drainOutput(out, file, 0);
+    if (spill) {
+        char chunk[BUFSIZ];
+        size_t len;
+        rewind(spill);
+        while ((len = fread(chunk, 1, sizeof(chunk), spill)) > 0) {
+            if (file)
+                fwrite(chunk, 1, len, file);
+            else
+                byteBufferWrite(out, (uint8_t*)chunk, len);
+        }
+    }
+    if (file)
+        byteBufferWriteToFile(buff, file);
+    else
+        byteBufferWrite(out, buff->buf, buff->len);
+}
+
+/**
+ * Get the LLVM operand of a number object.
+ * Literal is used as immediate value, variable is loaded into a new SSA value,
+ * and expression result is already an SSA value.
+ * @param obj Object* number literal or identifier
+ * @param operand char[OPERAND_BUFFER_LEN] output
+ */
+static void codegen_loadValue(const Object* obj, char* operand) {
+    CodegenState* cg = compilerContext->codegen;
+    if (obj->type != OBJECT_TYPE_IDENT) {
+        char* num = sciToStr(&obj->number);
+        snprintf(operand, OPERAND_BUFFER_LEN, "%s", num);
+        free(num);
+        return;
+    }
+
+    const SymbolData* symbol = obj->symbol;
+    if (symbol->expCache) {
+        snprintf(operand, OPERAND_BUFFER_LEN, "%%t.%d", symbol->index);
+        return;
+    }
+
+    // %t.N = load type, ptr %var.M
+    buffIndent(&cg->mainFunBuff);
+    byteBufferWriteLabel(&cg->mainFunBuff, "%t.", cg->variableCacheCount);
+    buffWrite(&cg->mainFunBuff, " = load ");
+    buffWrite(&cg->mainFunBuff, objectType2llvmType[symbol->type]);
+    byteBufferWriteLabel(&cg->mainFunBuff, ", ptr %var.", symbol->index);
+    buffWrite(&cg->mainFunBuff, "\n");
+    snprintf(operand, OPERAND_BUFFER_LEN, "%%t.%d", cg->variableCacheCount);
+    ++cg->variableCacheCount;
+}
+
+bool codegen_moduleBegin(const char* moduleName) {
+    CodegenState* cg = compilerContext->codegen = malloc(sizeof(CodegenState));
+    *cg = (CodegenState){
+        .strPool = constPoolInit(),
+        .mainFunBuff = byteBufferInit(),
+        .allocaBuff = byteBufferInit(),
+        .metadataBuff = byteBufferInit(),
+        .streaming = compilerContext->options.stream,
+        .moduleFileName = moduleName,
+        .metadataCount = 3,
+        .loopCheckpointList = linkedList_create(),
+    };
+    linkedList_init(&cg->loopCheckpointList);
+    return false;
+}
+
+bool codegen_moduleEnd() {
+    CodegenState* cg = compilerContext->codegen;
+    if (compilerContext->options.mergeStrings)
+        constPool_mergeSuffixes(&cg->strPool);
+    return false;
+}
+
+bool codegen_optimize(int optLevel) {
+    if (optLevel == 0)
+        return false;
+    reportFailuref("optimization requires compiler built with WENYAN_USE_LLVM, use opt on the output instead\n");
+    return true;
+}
+
+/** Write @str.N of the pool followed by a blank line, merged tail is an alias into its host */
+static void codegen_writeConstants(ByteBuffer* out, FILE* file) {
+    CodegenState* cg = compilerContext->codegen;
+    for (int32_t i = 0; i < cg->strPool.count; ++i) {
+        const ConstPoolEntry* entry = constPoolEntry(&cg->strPool, i);
+        if (entry->host >= 0) {
+            const ConstPoolEntry* host = constPoolEntry(&cg->strPool, entry->host);
+            byteBufferWriteFormat(out,
+                                  "@str.%d = private unnamed_addr alias i8, getelementptr inbounds (i8, ptr @str.%d, i64 %llu)\n",
+                                  i, entry->host, host->len - entry->len);
+        } else {
+            byteBufferWriteFormat(out, "@str.%d = private unnamed_addr constant [%llu x i8] c\"", i, entry->len);
+            byteBufferWriteStrUtf8(out, constPoolBytes(&cg->strPool, entry));
+            byteBufferWriteStr(out, "\"\n");
+        }
+        // Pool can be as large as the program, don't hold a second copy
+        drainOutput(out, file, STREAM_CHUNK_SIZE);
+    }
+    byteBufferWriteStr(out, "\n");
+}
+
+bool codegen_write(ByteBuffer* out, FILE* file, bool bitcode) {
+    CodegenState* cg = compilerContext->codegen;
+    if (bitcode) {
+        reportFailuref("bitcode output requires compiler built with WENYAN_USE_LLVM\n");
+        return true;
+    }
+
+    if (cg->moduleFileName) {
+        byteBufferWriteFormat(out, "; ModuleID = '%s'\n", cg->moduleFileName);
+        byteBufferWriteFormat(out, "source_filename = \"%s\"\n", cg->moduleFileName);
+    }
+    byteBufferWriteStr(out, "\n");
+    byteBufferWriteStr(out, (char*)runtimeSource);
+    byteBufferWriteStr(out, "\n");
+
+    // Constants are globals after main when streaming, the pool is complete only now either way
+    if (!cg->streaming)
+        codegen_writeConstants(out, file);
+    byteBufferWriteStr(out, "define i32 @main() mustprogress {\n");
+    byteBufferWriteStr(out, "    call void @wy_init()\n");
+    writeSpilled(&cg->allocaBuff, cg->allocaSpill, out, file);
+    writeSpilled(&cg->mainFunBuff, cg->mainFunSpill, out, file);
+    byteBufferWriteStr(out, "    call void @wy_flush()\n");
+    byteBufferWriteStr(out, "    ret i32 0\n");
+    byteBufferWriteStr(out, "}\n");
+    if (cg->streaming) {
+        byteBufferWriteStr(out, "\n");
+        codegen_writeConstants(out, file);
+    } else
+        byteBufferWriteStr(out, "\n");
+
+    byteBufferWriteStr(out, "!0 = !{!\"llvm.loop.mustprogress\"}\n");
+    byteBufferWriteStr(out, "!1 = !{!\"llvm.loop.unroll.enable\"}\n");
+    byteBufferWriteStr(out, "!2 = !{!\"llvm.loop.vectorize.enable\", i1 true}\n");
+    writeSpilled(&cg->metadataBuff, cg->metadataSpill, out, file);
+    drainOutput(out, file, 0);
+    return false;
+}
+
+bool codegen_run(int* exitCode) {
+    reportFailuref("--run requires compiler built with WENYAN_USE_LLVM\n");
+    return true;
+}
+
+void codegen_free() {
+    CodegenState* cg = compilerContext->codegen;
+    if (!cg) return;
+    if (cg->mainFunSpill) fclose(cg->mainFunSpill);
+    if (cg->allocaSpill) fclose(cg->allocaSpill);
+    if (cg->metadataSpill) fclose(cg->metadataSpill);
+    linkedList_free(&cg->loopCheckpointList);
+    constPool_free(&cg->strPool);
+    byteBufferFree(&cg->mainFunBuff, false);
+    byteBufferFree(&cg->allocaBuff, false);
+    byteBufferFree(&cg->metadataBuff, false);
+    free(cg);
+    compilerContext->codegen = NULL;
+}
+
+void codegen_printNumber(const Object* value, bool newLine) {
+    CodegenState* cg = compilerContext->codegen;
+    codegen_spill();
+    const char* typeName = objectType2llvmType[getObjectType(value)];
+    char operand[OPERAND_BUFFER_LEN];
+    codegen_loadValue(value, operand);
+    buffIndent(&cg->mainFunBuff);
+    buffWrite(&cg->mainFunBuff, "call void @wy_print_");
+    buffWrite(&cg->mainFunBuff, typeName);
+    buffWrite(&cg->mainFunBuff, "(");
+    buffWrite(&cg->mainFunBuff, typeName);
+    buffWrite(&cg->mainFunBuff, " ");
+    buffWrite(&cg->mainFunBuff, operand);
+    buffWrite(&cg->mainFunBuff, newLine ? ", i1 true)\n" : ", i1 false)\n");
+}
+
+/**
+ * Get string constant @str.N, same bytes share one constant
+ * @param str bytes, terminated by '\0' after len
+ * @return N
+ */
+static int codegen_constStr(const char* str, const size_t len, const bool newLine) {
+    CodegenState* cg = compilerContext->codegen;
+    return constPool_add(&cg->strPool, str, len, newLine, NULL);
+}
+
+void codegen_printStr(const char* str, bool newLine) {
+    CodegenState* cg = compilerContext->codegen;
+    codegen_spill();
+    const size_t len = strlen(str);
+    const int index = codegen_constStr(str, len, newLine);
+    buffIndent(&cg->mainFunBuff);
+    byteBufferWriteLabel(&cg->mainFunBuff, "call void @wy_write(ptr @str.", index);
+    byteBufferWriteLabel(&cg->mainFunBuff, ", i64 ", (int64_t)(len + newLine));
+    buffWrite(&cg->mainFunBuff, ")\n");
+}
+
+void codegen_flush() {
+    CodegenState* cg = compilerContext->codegen;
+    buffPrintln(&cg->mainFunBuff, "call void @wy_flush()");
+}
+
+// store type operand, ptr %var.N
+static void buffPrintStore(const char* typeName, const char* operand, const int32_t index) {
+    CodegenState* cg = compilerContext->codegen;
+    buffIndent(&cg->mainFunBuff);
+    buffWrite(&cg->mainFunBuff, "store ");
+    buffWrite(&cg->mainFunBuff, typeName);
+    buffWrite(&cg->mainFunBuff, " ");
+    buffWrite(&cg->mainFunBuff, operand);
+    byteBufferWriteLabel(&cg->mainFunBuff, ", ptr %var.", index);
+    buffWrite(&cg->mainFunBuff, "\n");
+}
+
+void codegen_createVariable(const SymbolData* symbol, const Object* value) {
+    CodegenState* cg = compilerContext->codegen;
+    codegen_spill();
+    char operand[OPERAND_BUFFER_LEN];
+    codegen_loadValue(value, operand);
+
+    // Stack slot is allocated in entry block, so loop body won't grow the stack
+    const char* typeName = objectType2llvmType[symbol->type];
+    byteBufferWriteFormat(&cg->allocaBuff, "    %%var.%d = alloca %s\n", symbol->index, typeName);
+    buffPrintln(&cg->mainFunBuff, "call void @llvm.lifetime.start.p0(i64 %d, ptr %%var.%d)",
+                objectType2llvmSize[symbol->type], symbol->index);
+    buffPrintStore(typeName, operand, symbol->index);
+}
+
+void codegen_storeVariable(const SymbolData* symbol, const Object* value) {
+    codegen_spill();
+    char operand[OPERAND_BUFFER_LEN];
+    codegen_loadValue(value, operand);
+    buffPrintStore(objectType2llvmType[symbol->type], operand, symbol->index);
+}
+
+void codegen_endVariable(const SymbolData* symbol) {
+    CodegenState* cg = compilerContext->codegen;
+    // End variables lifetime, let LLVM reuse the stack slot in sibling scope
+    buffPrintln(&cg->mainFunBuff, "call void @llvm.lifetime.end.p0(i64 %d, ptr %%var.%d)",
+                objectType2llvmSize[symbol->type], symbol->index);
+}
+
+static const char* getArithmeticInstr(const char op, const ObjectType type) {
+    const bool isFloat = type == OBJECT_TYPE_F64;
+    switch (op) {
+    case '+': return isFloat ? "fadd" : "add nsw";
+    case '-': return isFloat ? "fsub" : "sub nsw";
+    case '*': return isFloat ? "fmul" : "mul nsw";
+    case '/': return isFloat ? "fdiv" : "sdiv";
+    default: return NULL;
+    }
+}
+
+int32_t codegen_arithmetic(char op, ObjectType type, const Object* lhs, const Object* rhs) {
+    CodegenState* cg = compilerContext->codegen;
+    codegen_spill();
+    const char* typeName = objectType2llvmType[type];
+
+    // Operands are used directly as SSA values, no stack slot for temporary
+    char lhsOperand[OPERAND_BUFFER_LEN], rhsOperand[OPERAND_BUFFER_LEN];
+    codegen_loadValue(lhs, lhsOperand);
+    codegen_loadValue(rhs, rhsOperand);
+
+    // %t.N = instr type lhs, rhs
+    buffIndent(&cg->mainFunBuff);
+    byteBufferWriteLabel(&cg->mainFunBuff, "%t.", cg->variableCacheCount);
+    buffWrite(&cg->mainFunBuff, " = ");
+    buffWrite(&cg->mainFunBuff, getArithmeticInstr(op, type));
+    buffWrite(&cg->mainFunBuff, " ");
+    buffWrite(&cg->mainFunBuff, typeName);
+    buffWrite(&cg->mainFunBuff, " ");
+    buffWrite(&cg->mainFunBuff, lhsOperand);
+    buffWrite(&cg->mainFunBuff, ", ");
+    buffWrite(&cg->mainFunBuff, rhsOperand);
+    buffWrite(&cg->mainFunBuff, "\n");
+    return cg->variableCacheCount++;
+}
+
+/**
+ * Create llvm.loop metadata for loop latch branch
+ * @return metadata index
+ */
+static int codegen_loopMetadata() {
+    CodegenState* cg = compilerContext->codegen;
+    if (compilerContext->options.loopHints)
+        byteBufferWriteFormat(&cg->metadataBuff, "!%d = distinct !{!%d, !0, !1, !2}\n", cg->metadataCount, cg->metadataCount);
+    else
+        byteBufferWriteFormat(&cg->metadataBuff, "!%d = distinct !{!%d, !0}\n", cg->metadataCount, cg->metadataCount);
+    return cg->metadataCount++;
+}
+
+void codegen_forLoop(int32_t loopIndex, ObjectType type, const Object* count) {
+    CodegenState* cg = compilerContext->codegen;
+    codegen_spill();
+    LoopCheckpoint* checkpoint = malloc(sizeof(LoopCheckpoint));
+    *checkpoint = (LoopCheckpoint){
+        cg->mainFunBuff.len, cg->metadataBuff.len, cg->strPool.count, cg->metadataCount
+    };
+    linkedList_addp(&cg->loopCheckpointList, true, checkpoint);
+
+    // Create loop
+    buffPrintln(&cg->mainFunBuff, "");
+    buffPrintln(&cg->mainFunBuff, "br label %%loop%d.entry", loopIndex);
+    buffPrintln(&cg->mainFunBuff, "loop%d.entry:", loopIndex);
+
+    // Get loop count
+    const char* llvmType = objectType2llvmType[type];
+    char countOperand[OPERAND_BUFFER_LEN];
+    codegen_loadValue(count, countOperand);
+
+    buffPrintln(&cg->mainFunBuff, "    br label %%loop%d.header", loopIndex);
+    buffPrintln(&cg->mainFunBuff, "loop%d.header:", loopIndex);
+    buffPrintln(&cg->mainFunBuff, "    %%loop%d.i = phi %s [0, %%loop%d.entry], [%%loop%d.i.next, %%loop%d.update]",
+                loopIndex, llvmType, loopIndex, loopIndex, loopIndex);
+    buffPrintln(&cg->mainFunBuff, "    %%loop%d.cond = icmp slt %s %%loop%d.i, %s", loopIndex, llvmType, loopIndex,
+                countOperand);
+
+    buffPrintln(&cg->mainFunBuff, "    br i1 %%loop%d.cond, label %%loop%d.body, label %%loop%d.exit",
+                loopIndex, loopIndex, loopIndex);
+
+    buffPrintln(&cg->mainFunBuff, "loop%d.body:", loopIndex);
+}
+
+void codegen_forLoopEnd(int32_t loopIndex, ObjectType type) {
+    CodegenState* cg = compilerContext->codegen;
+    const char* llvmType = objectType2llvmType[type];
+
+    buffPrintln(&cg->mainFunBuff, "    br label %%loop%d.update", loopIndex);
+
+    buffPrintln(&cg->mainFunBuff, "loop%d.update:", loopIndex);
+    buffPrintln(&cg->mainFunBuff, "    %%loop%d.i.next = add nsw %s %%loop%d.i, 1", loopIndex, llvmType, loopIndex);
+    buffPrintln(&cg->mainFunBuff, "    br label %%loop%d.header, !llvm.loop !%d", loopIndex, codegen_loopMetadata());
+
+    buffPrintln(&cg->mainFunBuff, "loop%d.exit:", loopIndex);
+    buffPrintln(&cg->mainFunBuff, "");
+    linkedList_deleteNode(&cg->loopCheckpointList, cg->loopCheckpointList.head->prev);
+}
+
+void codegen_forLoopConstant(int32_t loopIndex, const uint8_t* output, size_t size, int64_t count) {
+    CodegenState* cg = compilerContext->codegen;
+    // Drop the loop, body only contains string constants and writes
+    const LoopCheckpoint* checkpoint = cg->loopCheckpointList.head->prev->value;
+    cg->mainFunBuff.len = checkpoint->mainFunLen;
+    cg->metadataBuff.len = checkpoint->metadataLen;
+    constPool_truncate(&cg->strPool, checkpoint->constStrCount);
+    cg->metadataCount = checkpoint->metadataCount;
+    linkedList_deleteNode(&cg->loopCheckpointList, cg->loopCheckpointList.head->prev);
+    if (size == 0 || count == 0)
+        return;
+
+    // Small output is repeated into one constant
+    if ((uint64_t)count <= CODEGEN_CONST_OUTPUT_LIMIT / size) {
+        const size_t totalSize = size * count;
+        char* data = malloc(totalSize + 1);
+        for (int64_t i = 0; i < count; ++i)
+            memcpy(data + i * size, output, size);
+        data[totalSize] = '\0';
+        const int index = codegen_constStr(data, totalSize, false);
+        buffPrintln(&cg->mainFunBuff, "call void @wy_write(ptr @str.%d, i64 %llu)", index, totalSize);
+        free(data);
+        return;
+    }
+
+    // Large output writes one iteration per loop
+    char* data = malloc(size + 1);
+    memcpy(data, output, size);
+    data[size] = '\0';
+    const int index = codegen_constStr(data, size, false);
+    free(data);
+
+    buffPrintln(&cg->mainFunBuff, "");
+    buffPrintln(&cg->mainFunBuff, "br label %%loop%d.entry", loopIndex);
+    buffPrintln(&cg->mainFunBuff, "loop%d.entry:", loopIndex);
+    buffPrintln(&cg->mainFunBuff, "    br label %%loop%d.header", loopIndex);
+    buffPrintln(&cg->mainFunBuff, "loop%d.header:", loopIndex);
+    buffPrintln(&cg->mainFunBuff, "    %%loop%d.i = phi i64 [0, %%loop%d.entry], [%%loop%d.i.next, %%loop%d.header]",
+                loopIndex, loopIndex, loopIndex, loopIndex);
+    buffPrintln(&cg->mainFunBuff, "    call void @wy_write(ptr @str.%d, i64 %llu)", index, size);
+    buffPrintln(&cg->mainFunBuff, "    %%loop%d.i.next = add nuw nsw i64 %%loop%d.i, 1", loopIndex, loopIndex);
+    buffPrintln(&cg->mainFunBuff, "    %%loop%d.cond = icmp ult i64 %%loop%d.i.next, %lld", loopIndex, loopIndex, count);
+    buffPrintln(&cg->mainFunBuff, "    br i1 %%loop%d.cond, label %%loop%d.header, label %%loop%d.exit, !llvm.loop !%d",
+                loopIndex, loopIndex, loopIndex, codegen_loopMetadata());
+    buffPrintln(&cg->mainFunBuff, "loop%d.exit:", loopIndex);
+    buffPrintln(&cg->mainFunBuff, "");
+}
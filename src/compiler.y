@@ -5,11 +5,17 @@
     #include "main.h"
     #include "object.h"
     #include "value_data.h"
-
-    void yyerror(char const* msg);
 %}
 
+%define api.pure full
 %define parse.error custom
+%lex-param {void* scanner}
+%parse-param {void* scanner}
+
+%code {
+    int yylex(YYSTYPE* yylval, void* scanner);
+    void yyerror(void* scanner, char const* msg);
+}
 
 /* Variable or self-defined structure */
 %union {
@@ -18,10 +24,10 @@
     bool b_var;
     ScientificNotation n_var;
     char *s_var;
+    const char *ident;
 
     Object obj_val;
-    ValueData val_data;
-    LinkedList ident_list;
+    ValueData* val_data;
     
     bool exp_left;
     char exp_op;
@@ -41,7 +47,7 @@
 %token <b_var> BOOL_LIT
 %token <n_var> NUMBER_LIT
 %token <s_var> STR_LIT
-%token <s_var> IDENT
+%token <ident> IDENT
 
 /* Nonterminal with return, which need to specify type */
 %type <obj_val> ExpressionStmt
@@ -91,26 +97,26 @@ ConditionStmt
 ;
 
 OperationStmt
-    : CreateValueDataListStmt PrintStmt { object_ValueDataListFree(&$<val_data>1); }
-    | CreateValueDataListStmt NAME_IT VariableDefineStmt { object_ValueDataListFree(&$<val_data>1); }
+    : CreateValueDataListStmt PrintStmt { object_ValueDataListFree($<val_data>1); }
+    | CreateValueDataListStmt NAME_IT VariableDefineStmt { object_ValueDataListFree($<val_data>1); }
     | PAST VariableStmt VARIABLE ASSIGN ExpressionOrValueStmt { if (code_assign(&$<obj_val>2, &$<obj_val>5)) YYABORT; } TO_IT
     | ExpressionStmt PAST VariableStmt { if (code_assign(&$<obj_val>3, &$<obj_val>1)) YYABORT; } VARIABLE ASSIGN THAT TO_IT
 ;
 
 PrintStmt
-    : PRINT { code_stdoutPrint(&$<val_data>0, true); }
-    | PrintStmt PRINT { code_stdoutPrint(&$<val_data>0, true); }
+    : PRINT { code_stdoutPrint($<val_data>0, true); }
+    | PrintStmt PRINT { code_stdoutPrint($<val_data>0, true); }
 ;
 
 VariableDefineStmt
-    : VariableDefineStmt SAID IDENT { code_createVariable(&$<val_data>-1, $<s_var>3); } 
-    | IDENT { code_createVariable(&$<val_data>-1, $<s_var>1); } 
+    : VariableDefineStmt SAID IDENT { code_createVariable($<val_data>-1, $<ident>3); } 
+    | IDENT { code_createVariable($<val_data>-1, $<ident>1); } 
 ;
 
 CreateValueDataListStmt:
     // 有數( 一 |「甲」)
-    HERE_IS_A VAR_TYPE { object_ValueDataListCreate($<var_type>2, &$<val_data>$); printf("%p\n", $<val_data>$.valueList.head); }
-        ExpressionOrValueStmt  { if (object_ValueDataListAdd(&$<val_data>3, &$<obj_val>4)) YYABORT; $$ = $<val_data>3; }
+    HERE_IS_A VAR_TYPE { object_ValueDataListCreate($<var_type>2, &$<val_data>$); tracef("%p\n", $<val_data>$); }
+        ExpressionOrValueStmt  { if (object_ValueDataListAdd($<val_data>3, &$<obj_val>4)) YYABORT; $$ = $<val_data>3; }
     
     // (吾有|今有)三數。曰一。曰三。曰五
     | HERE_ARE NUMBER_LIT VAR_TYPE { object_ValueDataListCreate($<var_type>3, &$<val_data>$); }
@@ -118,12 +124,12 @@ CreateValueDataListStmt:
     
     // 加一於二
     | ExpressionStmt 
-        { object_ValueDataListCreate($<obj_val>1.type, &$<val_data>$); if (object_ValueDataListAdd(&$<val_data>$, &$<obj_val>1)) YYABORT; }
+        { object_ValueDataListCreate($<obj_val>1.type, &$<val_data>$); if (object_ValueDataListAdd($<val_data>$, &$<obj_val>1)) YYABORT; }
 ;
 
 CreateValueDataList_AddValueDataStmt
-    : CreateValueDataList_AddValueDataStmt SAID ExpressionOrValueStmt { if (object_ValueDataListAdd(&$<val_data>0, &$<obj_val>3)) YYABORT; }
-    | SAID ExpressionOrValueStmt { if (object_ValueDataListAdd(&$<val_data>0, &$<obj_val>2)) YYABORT; }
+    : CreateValueDataList_AddValueDataStmt SAID ExpressionOrValueStmt { if (object_ValueDataListAdd($<val_data>0, &$<obj_val>3)) YYABORT; }
+    | SAID ExpressionOrValueStmt { if (object_ValueDataListAdd($<val_data>0, &$<obj_val>2)) YYABORT; }
 ;
 
 ExpressionOrValueStmt
@@ -144,15 +150,17 @@ ValueLiteralStmt
 ;
 
 VariableStmt
-    : IDENT { if (($$ = object_findIdentByName($<s_var>1)).type == OBJECT_TYPE_UNDEFINED) YYABORT; }
+    : IDENT { if (($$ = object_findIdentByName($<ident>1)).type == OBJECT_TYPE_UNDEFINED) YYABORT; }
 ;
 
 %%
 
-void yyerror(char const* msg) {
-    compileError = true;
-    fprintf(stderr, ERROR_PREFIX " %s\n", inputFilePath, yylineno, yycolumnUtf8 - yylengUtf8 + 1, msg);
-    printErrorLine();
+void yyerror(void* scanner, char const* msg) {
+    ByteBuffer message = byteBufferInit();
+    byteBufferWriteFormat(&message, " %s\n", (char*)msg);
+    byteBufferWrite(&message, (uint8_t*)"", 1);
+    reportError(compilerContext->inputFilePath, (char*)message.buf);
+    byteBufferFree(&message, false);
 }
 
 static const char* yysymbolNameCh(yysymbol_kind_t symbol) {
@@ -164,28 +172,28 @@ static const char* yysymbolNameCh(yysymbol_kind_t symbol) {
     }
 }
 
-static int yyreport_syntax_error(const yypcontext_t *ctx) {
-    compileError = true;
-    fprintf(stderr, ERROR_PREFIX, inputFilePath, yylineno, yycolumnUtf8 - yylengUtf8 + 1);
-    
+static int yyreport_syntax_error(const yypcontext_t *ctx, void* scanner) {
+    ByteBuffer message = byteBufferInit();
+
     // expecting token
     yysymbol_kind_t lookahead = yypcontext_token(ctx);
     if (lookahead != YYSYMBOL_YYEMPTY) {
-        fprintf(stderr, "忽逢%s，殊非所期", yysymbolNameCh(lookahead));
+        byteBufferWriteFormat(&message, "忽逢%s，殊非所期", yysymbolNameCh(lookahead));
     }
     
     enum { TOKENMAX = 10 };
     yysymbol_kind_t expected[TOKENMAX];
     int n = yypcontext_expected_tokens(ctx, expected, TOKENMAX);
     if (n > 0) {
-        fprintf(stderr, "，當得");
+        byteBufferWriteStr(&message, "，當得");
         for (int i = 0; i < n; ++i) {
-            if (i > 0) fprintf(stderr, "或");
-            fprintf(stderr, "%s", yysymbolNameCh(expected[i]));
+            if (i > 0) byteBufferWriteStr(&message, "或");
+            byteBufferWriteStr(&message, (char*)yysymbolNameCh(expected[i]));
         }
     }
-    fprintf(stderr, "\n");
-    
-    printErrorLine();
+    byteBufferWrite(&message, (uint8_t*)"\n", 2);
+
+    reportError(compilerContext->inputFilePath, (char*)message.buf);
+    byteBufferFree(&message, false);
     return 0;
 }
\ No newline at end of file
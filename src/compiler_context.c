@@ -0,0 +1,47 @@
+#include "compiler_context.h"
+
+#include "codegen.h"
+#include "compiler_util.h"
+
+_Thread_local CompilerContext* compilerContext = NULL;
+
+bool compilerContext_init(CompilerContext* ctx, const WenyanOptions* options) {
+    // Zero is the empty state of every other member
+    *ctx = (CompilerContext){
+        .options = *options,
+        .frontendArena = arenaInit(),
+        .scopeArenaMarks = byteBufferInit(),
+        .loopLabelList = linkedList_create(),
+        .lexer = {.unregCharStop = true, .strBuffer = byteBufferInit()},
+    };
+    linkedList_init(&ctx->loopLabelList);
+    compilerContext = ctx;
+    return yylex_init_extra(ctx, &ctx->scanner) != 0;
+}
+
+bool compilerContext_compile(CompilerContext* ctx) {
+    if (codegen_moduleBegin(ctx->inputFileName))
+        return true;
+
+    yyset_lineno(1, ctx->scanner);
+    yyparse(ctx->scanner);
+
+    return ctx->compileError || codegen_moduleEnd() || codegen_optimize(ctx->options.optLevel);
+}
+
+void compilerContext_free(CompilerContext* ctx) {
+    compilerContext = ctx;
+    symbolTable_free();
+    object_ValueDataFreeAll();
+    arenaFree(&ctx->frontendArena);
+    byteBufferFree(&ctx->scopeArenaMarks, false);
+    linkedList_free(&ctx->loopLabelList);
+    codegen_free();
+    if (ctx->scanner)
+        yylex_destroy(ctx->scanner);
+    // Buffer of string literal being scanned from input
+    byteBufferFree(&ctx->lexer.strBuffer, false);
+    sourceUnmap();
+    intern_free();
+    compilerContext = NULL;
+}
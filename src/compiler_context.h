@@ -0,0 +1,83 @@
+#ifndef WENYAN_LLVM_COMPILER_CONTEXT_H
+#define WENYAN_LLVM_COMPILER_CONTEXT_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "intern.h"
+#include "source.h"
+#include "symbol_table.h"
+#include "value_data.h"
+#include "wenyan.h"
+#include "lib/arena.h"
+#include "lib/byte_buffer.h"
+
+#include "WJCL/list/wjcl_linked_list.h"
+
+/*
+ * State of one compilation. Every module works on the context current on its thread,
+ * so files compiled on different threads share nothing.
+ */
+
+/** Defined by the code generation backend */
+typedef struct CodegenState CodegenState;
+
+typedef struct {
+    // Byte position only, UTF-8 column is counted when reporting error
+    int column;
+    int offset;
+    bool unregChar;
+    bool unregCharStop;
+    // Literal text from mapped source, NULL if collected in strBuffer
+    char* strStart;
+    ByteBuffer strBuffer;
+} LexerState;
+
+typedef struct CompilerContext {
+    WenyanOptions options;
+    const char* inputFilePath;
+    const char* inputFileName;
+    // WenyanDiagnostic[] errors are recorded in, NULL to print them to stderr
+    ByteBuffer* diagnostics;
+    // Print parser trace to stdout
+    bool trace;
+    // Reentrant scanner, its extra data is this context
+    void* scanner;
+    bool compileError;
+    int scopeLevel;
+
+    // Frontend objects of this compilation, each scope releases what it allocated at dumpScope
+    Arena frontendArena;
+    /** ArenaMark[], frontendArena state when each open scope is pushed */
+    ByteBuffer scopeArenaMarks;
+    /** LinkedList<LoopInfo>, open loops of main.c */
+    LinkedList loopLabelList;
+    int loopLabelCount;
+    int variableCount;
+
+    LexerState lexer;
+    SourceState source;
+    InternTable intern;
+    SymbolTable symbolTable;
+    ValueDataPool valueData;
+    // Created by codegen_moduleBegin
+    CodegenState* codegen;
+} CompilerContext;
+
+/** Context of the compilation running on this thread */
+extern _Thread_local CompilerContext* compilerContext;
+
+/**
+ * Init ctx with a new scanner and make it current on this thread
+ * @return true if failed
+ */
+bool compilerContext_init(CompilerContext* ctx, const WenyanOptions* options);
+/**
+ * Parse input of the scanner into a finished module, optimized to options.optLevel
+ * @return true if failed
+ */
+bool compilerContext_compile(CompilerContext* ctx);
+/** Free everything ctx holds, ctx must be current */
+void compilerContext_free(CompilerContext* ctx);
+
+#endif //WENYAN_LLVM_COMPILER_CONTEXT_H
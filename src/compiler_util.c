@@ -1,7 +1,11 @@
 #include "compiler_util.h"
 
+#include <stdarg.h>
+#include <stdlib.h>
 #include <utf8.c/utf8.h>
 
+#include "source.h"
+
 void checkNewline(char* str, size_t len) {
     if (str[len - 2] == '\r') {
         str[len - 2] = '\n';
@@ -78,26 +82,51 @@ uint32_t decode_utf8(const char* str, const uint8_t byte_len) {
     }
 }
 
-void printErrorLine() {
-    // Read error line
-    fseek(yyin, yyoffset - yycolumn, SEEK_SET);
+int getErrorColumn() {
+    // Count UTF-8 characters from line start to token start
+    const int prefixLen = compilerContext->lexer.column - yyget_leng(compilerContext->scanner);
+    if (prefixLen <= 0)
+        return 1;
+
+    char* prefix = malloc(prefixLen + 1);
+    if (sourceLine(currentLineNumber(), prefix, prefixLen + 1)) {
+        free(prefix);
+        return prefixLen + 1;
+    }
+
+    int column = 1;
+    for (size_t i = 0; prefix[i]; i++)
+        if (((uint8_t)prefix[i] & 0xC0) != 0x80) column++;
+    free(prefix);
+    return column;
+}
 
+void printErrorLine() {
     char cache[ERROR_TEXT_BUFFER_LEN + 2], token[ERROR_TOKEN_BUFFER_LEN + 1];
-    cache[0] = 0;
+    const int lineNumber = currentLineNumber(), tokenLeng = yyget_leng(compilerContext->scanner);
 
-    // Read the error line from input file.
-    fgets(cache, ERROR_TEXT_BUFFER_LEN, yyin);
-    checkNewline(cache, strlen(cache));
+    // Read the error line from source line index
+    if (sourceLine(lineNumber, cache, ERROR_TEXT_BUFFER_LEN))
+        return;
+    size_t len = strlen(cache);
+    if (len >= 2) checkNewline(cache, len);
+    const int lineLen = (int)strlen(cache);
 
     // Extract the error token from the line.
-    int startIndex = yycolumn - yyleng;
-    memcpy(token, cache + startIndex, yyleng);
-    token[yyleng] = 0;
+    int startIndex = compilerContext->lexer.column - tokenLeng;
+    if (startIndex < 0) startIndex = 0;
+    if (startIndex > lineLen) startIndex = lineLen;
+    int tokenLen = tokenLeng;
+    if (tokenLen > ERROR_TOKEN_BUFFER_LEN) tokenLen = ERROR_TOKEN_BUFFER_LEN;
+    if (tokenLen > lineLen - startIndex) tokenLen = lineLen - startIndex;
+    memcpy(token, cache + startIndex, tokenLen);
+    token[tokenLen] = 0;
+    const char* suffix = cache + startIndex + tokenLen;
     // Split line
     cache[startIndex] = 0;
 
     // calculate width
-    int prefixWidth = startIndex, tokenWidth = yyleng;
+    int prefixWidth = startIndex, tokenWidth = tokenLen;
     utf8_string utf8Str = make_utf8_string(cache);
     if (utf8Str.str) {
         prefixWidth = 0;
@@ -124,19 +153,65 @@ void printErrorLine() {
     }
 
     // Print the error line
-    printf("%6d |%s" COLOR_RED "%s" COLOR_RESET "%s", yylineno, cache, token, cache + yycolumn);
+    printf("%6d |%s" COLOR_RED "%s" COLOR_RESET "%s", lineNumber, cache, token, suffix);
     printf("       |%*.s" COLOR_RED "^", prefixWidth, "");
     for (size_t i = 1; i < tokenWidth; i++) printf("~");
     printf(COLOR_RESET "\n");
 
     // Read additional context
-    cache[0] = 0;
-    fgets(cache, ERROR_TEXT_BUFFER_LEN, yyin);
-    size_t len = strlen(cache);
+    if (sourceLine(lineNumber + 1, cache, ERROR_TEXT_BUFFER_LEN))
+        return;
+    len = strlen(cache);
     if (!len) return;
-    checkNewline(cache, len);
+    if (len >= 2) checkNewline(cache, len);
     len = strlen(cache);
     if (cache[len - 1] == '\n' && len == 1)
         return;
-    printf("%6d |%s", yylineno + 1, cache);
+    printf("%6d |%s", lineNumber + 1, cache);
+}
+
+/** Append message to diagnostics without surrounding whitespace */
+static void recordDiagnostic(const int line, const int column, const char* message) {
+    const char* end = message + strlen(message);
+    while (*message == ' ' || *message == '\n') ++message;
+    while (end > message && (end[-1] == ' ' || end[-1] == '\n')) --end;
+    const WenyanDiagnostic diagnostic = {line, column, malloc(end - message + 1)};
+    memcpy(diagnostic.message, message, end - message);
+    diagnostic.message[end - message] = '\0';
+    byteBufferWrite(compilerContext->diagnostics, (uint8_t*)&diagnostic, sizeof(WenyanDiagnostic));
+}
+
+void reportError(const char* path, const char* message) {
+    compilerContext->compileError = true;
+    if (compilerContext->diagnostics) {
+        recordDiagnostic(currentLineNumber(), getErrorColumn(), message);
+        return;
+    }
+    fprintf(stderr, ERROR_PREFIX "%s", path, currentLineNumber(), getErrorColumn(), message);
+    printErrorLine();
+}
+
+void reportErrorf(const char* format, ...) {
+    ByteBuffer message = byteBufferInit();
+    va_list args;
+    va_start(args, format);
+    byteBufferWriteFormatV(&message, format, args);
+    va_end(args);
+    byteBufferWrite(&message, (uint8_t*)"", 1);
+    reportError(compilerContext->inputFileName, (char*)message.buf);
+    byteBufferFree(&message, false);
+}
+
+void reportFailuref(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (compilerContext->diagnostics) {
+        ByteBuffer message = byteBufferInit();
+        byteBufferWriteFormatV(&message, format, args);
+        byteBufferWrite(&message, (uint8_t*)"", 1);
+        recordDiagnostic(0, 0, (char*)message.buf);
+        byteBufferFree(&message, false);
+    } else
+        vfprintf(stderr, format, args);
+    va_end(args);
 }
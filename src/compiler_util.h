@@ -6,30 +6,24 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "compiler_context.h"
+#include "lib/arena.h"
 #include "lib/byte_buffer.h"
 
-// Internal variable
-extern int yylineno;
-extern int yyleng;
-extern int yychar;
-extern FILE* yyout;
-extern FILE* yyin;
-extern int yyparse();
-extern int yylex();
-extern int yylex_destroy();
+// Reentrant scanner and pure parser, yyscan_t is void*
+extern int yyparse(void* scanner);
+extern int yylex_init_extra(CompilerContext* extra, void** scanner);
+extern int yylex_destroy(void* scanner);
+extern void yyset_in(FILE* in, void* scanner);
+extern int yyget_lineno(void* scanner);
+extern void yyset_lineno(int lineNumber, void* scanner);
+extern int yyget_leng(void* scanner);
+// Scan text with 2 '\0' padding in place, instead of reading input file
+extern void yyScanSource(void* scanner, char* data, size_t size);
 
-// Custom variable
-extern int yycolumn;
-extern int yyoffset;
-extern int yycolumnUtf8;
-extern int yylengUtf8;
+// Line of the token being scanned in current compilation
+#define currentLineNumber() yyget_lineno(compilerContext->scanner)
 
-extern char *inputFilePath, *inputFileName;
-extern ByteBuffer methodBuff, constBuff, mainFunBuff;
-extern bool compileError;
-extern int scopeLevel;
-
-#define cloneStruct(type, ptr) memcpy(malloc(sizeof(type)), ptr, sizeof(type))
 
 #define ERROR_PREFIX "%s:%d:%d: 錯誤: "
 #define ERROR_TEXT_BUFFER_LEN 128
@@ -37,28 +31,38 @@ extern int scopeLevel;
 #define COLOR_RED "\033[31m"
 #define COLOR_YELLOW "\033[33m"
 #define COLOR_RESET "\033[0m"
+// Indent stops growing past this level, so output size stays linear in deeply nested source
+#define SCOPE_SPACE_MAX_LEVEL 16
 #define SCOPE_SPACE_FMT "%*s"
-#define SCOPE_SPACE_VAL scopeLevel << 2, ""
-
-#define code(format, ...) \
-fprintf(yyout, SCOPE_SPACE_FMT format "\n", SCOPE_SPACE_VAL, __VA_ARGS__)
-#define codeRaw(code) \
-fprintf(yyout, SCOPE_SPACE_FMT code "\n", SCOPE_SPACE_VAL)
+#define SCOPE_SPACE_WIDTH \
+    ((compilerContext->scopeLevel < SCOPE_SPACE_MAX_LEVEL ? compilerContext->scopeLevel : SCOPE_SPACE_MAX_LEVEL) << 2)
+#define SCOPE_SPACE_VAL SCOPE_SPACE_WIDTH, ""
 
-#define yyerroraf(format, ...)                                                                        \
-    {                                                                                                 \
-        compileError = true;                                                                          \
-        fprintf(stderr, ERROR_PREFIX format, inputFileName, yylineno, yycolumnUtf8 - yylengUtf8 + 1, ##__VA_ARGS__); \
-        printErrorLine();                                                                             \
-        YYABORT;                                                                                      \
-    }
-#define yyerrorf(format, ...)                                                                         \
-    {                                                                                                 \
-        compileError = true;                                                                          \
-        fprintf(stderr, ERROR_PREFIX format, inputFileName, yylineno, yycolumnUtf8 - yylengUtf8 + 1, ##__VA_ARGS__); \
-        printErrorLine();                                                                             \
+#define yyerroraf(format, ...)                  \
+    {                                           \
+        reportErrorf(format, ##__VA_ARGS__);    \
+        YYABORT;                                \
     }
+#define yyerrorf(format, ...) reportErrorf(format, ##__VA_ARGS__)
+
+// Parser trace of the command line compiler
+#define tracef(format, ...)                                 \
+    do {                                                    \
+        if (compilerContext->trace)                         \
+            printf(format, ##__VA_ARGS__);                  \
+    } while (0)
+
+/**
+ * Report compile error at current token, printed with the error line or recorded in diagnostics
+ * @param path file name printed in front of the error
+ */
+void reportError(const char* path, const char* message);
+/** Report compile error at current token of input file */
+void reportErrorf(const char* format, ...);
+/** Report failure not tied to source, like an output or backend error */
+void reportFailuref(const char* format, ...);
 
+int getErrorColumn();
 void printErrorLine();
 
 #endif
@@ -0,0 +1,138 @@
+#include "const_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CONST_POOL_INIT_SLOTS 64
+
+// FNV-1a
+static uint32_t hashBytes(const char* str, const size_t len, const bool newLine) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; ++i)
+        hash = (hash ^ (uint8_t)str[i]) * 16777619u;
+    if (newLine)
+        hash = (hash ^ '\n') * 16777619u;
+    return hash;
+}
+
+static bool entryEquals(const ConstPool* pool, const ConstPoolEntry* entry,
+                        const char* str, const size_t len, const bool newLine) {
+    if (entry->len != len + newLine)
+        return false;
+    const char* bytes = constPoolBytes(pool, entry);
+    return memcmp(bytes, str, len) == 0 && (!newLine || bytes[len] == '\n');
+}
+
+static void insertSlot(int32_t* slots, const size_t slotCount, const uint32_t hash, const int32_t index) {
+    size_t slot = hash & (slotCount - 1);
+    while (slots[slot])
+        slot = (slot + 1) & (slotCount - 1);
+    slots[slot] = index + 1;
+}
+
+static void growSlots(ConstPool* pool) {
+    const size_t slotCount = pool->slotCount ? pool->slotCount * 2 : CONST_POOL_INIT_SLOTS;
+    int32_t* slots = calloc(slotCount, sizeof(int32_t));
+    // Reinsert in index order, so truncate can still remove entries from the end
+    for (int32_t i = 0; i < pool->count; ++i)
+        insertSlot(slots, slotCount, constPoolEntry(pool, i)->hash, i);
+    free(pool->slots);
+    pool->slots = slots;
+    pool->slotCount = slotCount;
+}
+
+int32_t constPool_add(ConstPool* pool, const char* str, const size_t len, const bool newLine, bool* created) {
+    const uint32_t hash = hashBytes(str, len, newLine);
+    if (pool->slotCount) {
+        for (size_t slot = hash & (pool->slotCount - 1); pool->slots[slot];
+             slot = (slot + 1) & (pool->slotCount - 1)) {
+            const int32_t index = pool->slots[slot] - 1;
+            const ConstPoolEntry* entry = constPoolEntry(pool, index);
+            if (entry->hash == hash && entryEquals(pool, entry, str, len, newLine)) {
+                if (created) *created = false;
+                return index;
+            }
+        }
+    }
+
+    // Keep load factor under half
+    if ((size_t)(pool->count + 1) * 2 > pool->slotCount)
+        growSlots(pool);
+
+    const ConstPoolEntry entry = {pool->data.len, len + newLine, hash, -1};
+    byteBufferWrite(&pool->data, (uint8_t*)str, len);
+    if (newLine) byteBufferWrite(&pool->data, (uint8_t*)"\n", 1);
+    byteBufferWrite(&pool->data, (uint8_t*)"", 1);
+    byteBufferWrite(&pool->entries, (uint8_t*)&entry, sizeof(ConstPoolEntry));
+
+    const int32_t index = pool->count++;
+    insertSlot(pool->slots, pool->slotCount, hash, index);
+    if (created) *created = true;
+    return index;
+}
+
+void constPool_truncate(ConstPool* pool, const int32_t count) {
+    // Remove newest entries first, with linear probing no remaining entry was placed after them
+    for (int32_t index = pool->count - 1; index >= count; --index) {
+        size_t slot = constPoolEntry(pool, index)->hash & (pool->slotCount - 1);
+        while (pool->slots[slot] != index + 1)
+            slot = (slot + 1) & (pool->slotCount - 1);
+        pool->slots[slot] = 0;
+    }
+    if (count < pool->count) {
+        pool->data.len = constPoolEntry(pool, count)->offset;
+        pool->entries.len = count * sizeof(ConstPoolEntry);
+        pool->count = count;
+    }
+}
+
+typedef struct {
+    const char* end;
+    size_t len;
+    int32_t index;
+} SuffixKey;
+
+// Order by reversed bytes, a suffix comes right before the entries ending with it
+static int compareSuffix(const void* a, const void* b) {
+    const SuffixKey* keyA = a;
+    const SuffixKey* keyB = b;
+    const size_t len = keyA->len < keyB->len ? keyA->len : keyB->len;
+    for (size_t i = 1; i <= len; ++i) {
+        const uint8_t byteA = keyA->end[-i], byteB = keyB->end[-i];
+        if (byteA != byteB)
+            return byteA < byteB ? -1 : 1;
+    }
+    return keyA->len < keyB->len ? -1 : keyA->len > keyB->len;
+}
+
+void constPool_mergeSuffixes(ConstPool* pool) {
+    if (pool->count < 2)
+        return;
+    SuffixKey* keys = malloc(pool->count * sizeof(SuffixKey));
+    for (int32_t i = 0; i < pool->count; ++i) {
+        const ConstPoolEntry* entry = constPoolEntry(pool, i);
+        keys[i] = (SuffixKey){constPoolBytes(pool, entry) + entry->len, entry->len, i};
+    }
+    qsort(keys, pool->count, sizeof(SuffixKey), compareSuffix);
+
+    // Walk from the longest of each group, every key between a suffix and its host also ends with it
+    const SuffixKey* host = NULL;
+    for (int32_t i = pool->count - 1; i >= 0; --i) {
+        const SuffixKey* key = &keys[i];
+        if (host && key->len <= host->len &&
+            memcmp(key->end - key->len, host->end - key->len, key->len) == 0) {
+            constPoolEntry(pool, key->index)->host = host->index;
+        } else {
+            constPoolEntry(pool, key->index)->host = -1;
+            host = key;
+        }
+    }
+    free(keys);
+}
+
+void constPool_free(ConstPool* pool) {
+    byteBufferFree(&pool->data, false);
+    byteBufferFree(&pool->entries, false);
+    free(pool->slots);
+    *pool = (ConstPool)constPoolInit();
+}
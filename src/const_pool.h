@@ -0,0 +1,48 @@
+#ifndef WENYAN_LLVM_CONST_POOL_H
+#define WENYAN_LLVM_CONST_POOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lib/byte_buffer.h"
+
+/*
+ * Pool of string constants, one entry per distinct byte sequence.
+ * Entry index is stable and used as N of @str.N, entries added after a loop checkpoint
+ * are dropped with constPool_truncate.
+ */
+
+typedef struct {
+    size_t offset; // Position of the bytes in ConstPool.data
+    size_t len;
+    uint32_t hash;
+    // Entry holding this one as its tail after constPool_mergeSuffixes, -1 if standalone
+    int32_t host;
+} ConstPoolEntry;
+
+typedef struct {
+    ByteBuffer data; // Bytes of every entry, each followed by '\0'
+    ByteBuffer entries; // ConstPoolEntry[]
+    int32_t* slots; // Open addressing hash index, entry index + 1, 0 if empty
+    size_t slotCount;
+    int32_t count;
+} ConstPool;
+
+#define constPoolInit() \
+{ byteBufferInit(), byteBufferInit(), NULL, 0, 0 }
+#define constPoolEntry(pool, index) (((ConstPoolEntry*)(pool)->entries.buf) + (index))
+#define constPoolBytes(pool, entry) ((const char*)(pool)->data.buf + (entry)->offset)
+
+/**
+ * Find or add constant of str followed by optional newline
+ * @param created output, true if a new entry is added, can be NULL
+ * @return entry index
+ */
+int32_t constPool_add(ConstPool* pool, const char* str, size_t len, bool newLine, bool* created);
+/** Drop entries added after the pool had count entries */
+void constPool_truncate(ConstPool* pool, int32_t count);
+/** Point every entry that is the tail of a longer entry at it, see ConstPoolEntry.host */
+void constPool_mergeSuffixes(ConstPool* pool);
+void constPool_free(ConstPool* pool);
+
+#endif //WENYAN_LLVM_CONST_POOL_H
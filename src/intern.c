@@ -0,0 +1,75 @@
+#include "intern.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "compiler_context.h"
+
+#define INTERN_INIT_SLOTS 64
+
+struct InternEntry {
+    uint32_t hash;
+    uint32_t len;
+    char str[];
+};
+
+#define entryOf(interned) ((const InternEntry*)((interned) - offsetof(InternEntry, str)))
+
+// FNV-1a
+static uint32_t hashBytes(const char* str, const size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; ++i)
+        hash = (hash ^ (uint8_t)str[i]) * 16777619u;
+    return hash;
+}
+
+static void growSlots(InternTable* table) {
+    const size_t newSlotCount = table->slotCount ? table->slotCount * 2 : INTERN_INIT_SLOTS;
+    InternEntry** newSlots = calloc(newSlotCount, sizeof(InternEntry*));
+    for (size_t i = 0; i < table->slotCount; ++i) {
+        if (!table->slots[i]) continue;
+        size_t slot = table->slots[i]->hash & (newSlotCount - 1);
+        while (newSlots[slot])
+            slot = (slot + 1) & (newSlotCount - 1);
+        newSlots[slot] = table->slots[i];
+    }
+    free(table->slots);
+    table->slots = newSlots;
+    table->slotCount = newSlotCount;
+}
+
+const char* intern_string(const char* str, const size_t len) {
+    InternTable* table = &compilerContext->intern;
+    // Keep load factor under half
+    if ((table->entryCount + 1) * 2 > table->slotCount)
+        growSlots(table);
+
+    const uint32_t hash = hashBytes(str, len);
+    size_t slot = hash & (table->slotCount - 1);
+    for (; table->slots[slot]; slot = (slot + 1) & (table->slotCount - 1)) {
+        const InternEntry* entry = table->slots[slot];
+        if (entry->hash == hash && entry->len == len && memcmp(entry->str, str, len) == 0)
+            return entry->str;
+    }
+
+    InternEntry* entry = malloc(sizeof(InternEntry) + len + 1);
+    entry->hash = hash;
+    entry->len = len;
+    memcpy(entry->str, str, len);
+    entry->str[len] = '\0';
+    table->slots[slot] = entry;
+    ++table->entryCount;
+    return entry->str;
+}
+
+uint32_t intern_hash(const char* interned) {
+    return entryOf(interned)->hash;
+}
+
+void intern_free() {
+    InternTable* table = &compilerContext->intern;
+    for (size_t i = 0; i < table->slotCount; ++i)
+        free(table->slots[i]);
+    free(table->slots);
+    *table = (InternTable){NULL, 0, 0};
+}
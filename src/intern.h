@@ -0,0 +1,32 @@
+#ifndef WENYAN_LLVM_INTERN_H
+#define WENYAN_LLVM_INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Identifier interning, every distinct name is stored once with its hash.
+ * Interned strings of the same text are the same pointer, and live until intern_free.
+ * Table belongs to the current compilerContext.
+ */
+
+typedef struct InternEntry InternEntry;
+
+/** Intern table of one compilation, in CompilerContext */
+typedef struct {
+    /** Open addressing table of InternEntry*, NULL if empty */
+    InternEntry** slots;
+    size_t slotCount;
+    size_t entryCount;
+} InternTable;
+
+/**
+ * Get the interned copy of str
+ * @param len bytes of str, str doesn't need to be terminated
+ */
+const char* intern_string(const char* str, size_t len);
+/** Precomputed hash of an interned string */
+uint32_t intern_hash(const char* interned);
+void intern_free();
+
+#endif //WENYAN_LLVM_INTERN_H
@@ -0,0 +1,74 @@
+#include "arena.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ARENA_BLOCK_SIZE 16384
+#define ARENA_ALIGN _Alignof(max_align_t)
+
+struct ArenaBlock {
+    ArenaBlock* prev;
+    size_t size;
+    size_t used;
+    _Alignas(max_align_t) uint8_t data[];
+};
+
+static ArenaBlock* arenaNewBlock(Arena* arena, const size_t size) {
+    // Reuse spare block if large enough
+    if (arena->spare && arena->spare->size >= size) {
+        ArenaBlock* block = arena->spare;
+        arena->spare = block->prev;
+        block->prev = arena->block;
+        block->used = 0;
+        return arena->block = block;
+    }
+
+    const size_t blockSize = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+    ArenaBlock* block = malloc(sizeof(ArenaBlock) + blockSize);
+    if (block == NULL) {
+        fprintf(stderr, "Arena: malloc failed\n");
+        exit(1);
+    }
+    *block = (ArenaBlock){arena->block, blockSize, 0};
+    return arena->block = block;
+}
+
+void* arenaAlloc(Arena* arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    ArenaBlock* block = arena->block;
+    if (!block || block->size - block->used < size)
+        block = arenaNewBlock(arena, size);
+    void* ptr = block->data + block->used;
+    block->used += size;
+    return ptr;
+}
+
+ArenaMark arenaMark(const Arena* arena) {
+    return (ArenaMark){arena->block, arena->block ? arena->block->used : 0};
+}
+
+void arenaRelease(Arena* arena, const ArenaMark mark) {
+    while (arena->block != mark.block) {
+        ArenaBlock* block = arena->block;
+        arena->block = block->prev;
+        block->prev = arena->spare;
+        arena->spare = block;
+    }
+    if (arena->block)
+        arena->block->used = mark.used;
+}
+
+static void freeBlocks(ArenaBlock* block) {
+    while (block) {
+        ArenaBlock* prev = block->prev;
+        free(block);
+        block = prev;
+    }
+}
+
+void arenaFree(Arena* arena) {
+    freeBlocks(arena->block);
+    freeBlocks(arena->spare);
+    arena->block = arena->spare = NULL;
+}
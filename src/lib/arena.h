@@ -0,0 +1,36 @@
+#ifndef ARENA_H
+#define ARENA_H
+#include <stddef.h>
+#include <string.h>
+
+typedef struct ArenaBlock ArenaBlock;
+
+/** Bump allocator, memory is only released all at once or back to a mark */
+typedef struct Arena {
+    ArenaBlock* block;
+    // Released blocks kept for reuse
+    ArenaBlock* spare;
+} Arena;
+
+/** Allocation state to release back to, like a sub-arena on top of the arena */
+typedef struct {
+    ArenaBlock* block;
+    size_t used;
+} ArenaMark;
+
+#define arenaInit() \
+{ NULL, NULL }
+#define arenaNew(arena, type) ((type*)arenaAlloc(arena, sizeof(type)))
+#define arenaClone(arena, type, ptr) ((type*)memcpy(arenaAlloc(arena, sizeof(type)), ptr, sizeof(type)))
+
+/** Allocate size bytes aligned for any type, never NULL */
+void* arenaAlloc(Arena* arena, size_t size);
+
+ArenaMark arenaMark(const Arena* arena);
+
+/** Release everything allocated after mark was taken */
+void arenaRelease(Arena* arena, ArenaMark mark);
+
+void arenaFree(Arena* arena);
+
+#endif //ARENA_H
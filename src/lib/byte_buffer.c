@@ -7,7 +7,9 @@
 #include <stdint.h>
 #include <string.h>
 
-#include "WJCL/string/wjcl_string.h"
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 #define BUFFER_INIT_SIZE 1024
 #define BUFFER_GROW_FACTOR 2
@@ -15,10 +17,11 @@
 void byteBufferAddLen(ByteBuffer* byteBuffer, size_t len) {
     byteBuffer->len += len;
     if (byteBuffer->len > byteBuffer->bufLen) {
-        if (byteBuffer->bufLen)
-            byteBuffer->bufLen *= BUFFER_GROW_FACTOR;
-        else
+        if (!byteBuffer->bufLen)
             byteBuffer->bufLen = BUFFER_INIT_SIZE;
+        // Large write can need more than one step
+        while (byteBuffer->len > byteBuffer->bufLen)
+            byteBuffer->bufLen *= BUFFER_GROW_FACTOR;
         void* buf = (uint8_t*)realloc(byteBuffer->buf, byteBuffer->bufLen);
 
         if (buf == NULL) {
@@ -30,35 +33,125 @@ void byteBufferAddLen(ByteBuffer* byteBuffer, size_t len) {
     }
 }
 
-char to_hex_char(uint8_t digit) {
-    if (digit < 10)
-        return digit + '0';
-    return digit - 10 + 'A';
+#define HEX_DIGIT(d) ((d) < 10 ? '0' + (d) : 'A' + (d) - 10)
+#define ESCAPE_ENTRY(b) {'\\', HEX_DIGIT((b) >> 4), HEX_DIGIT((b) & 0xF)}
+#define ESCAPE_ROW(h)                                                                           \
+    ESCAPE_ENTRY(h * 16 + 0), ESCAPE_ENTRY(h * 16 + 1), ESCAPE_ENTRY(h * 16 + 2), ESCAPE_ENTRY(h * 16 + 3),     \
+    ESCAPE_ENTRY(h * 16 + 4), ESCAPE_ENTRY(h * 16 + 5), ESCAPE_ENTRY(h * 16 + 6), ESCAPE_ENTRY(h * 16 + 7),     \
+    ESCAPE_ENTRY(h * 16 + 8), ESCAPE_ENTRY(h * 16 + 9), ESCAPE_ENTRY(h * 16 + 10), ESCAPE_ENTRY(h * 16 + 11),   \
+    ESCAPE_ENTRY(h * 16 + 12), ESCAPE_ENTRY(h * 16 + 13), ESCAPE_ENTRY(h * 16 + 14), ESCAPE_ENTRY(h * 16 + 15)
+
+// "\XX" of every byte
+static const char escapeTable[256][3] = {
+    ESCAPE_ROW(0), ESCAPE_ROW(1), ESCAPE_ROW(2), ESCAPE_ROW(3), ESCAPE_ROW(4), ESCAPE_ROW(5), ESCAPE_ROW(6),
+    ESCAPE_ROW(7), ESCAPE_ROW(8), ESCAPE_ROW(9), ESCAPE_ROW(10), ESCAPE_ROW(11), ESCAPE_ROW(12), ESCAPE_ROW(13),
+    ESCAPE_ROW(14), ESCAPE_ROW(15),
+};
+
+// Byte written as is inside c"", quote and backslash have to be escaped too
+#define IS_LITERAL_BYTE(b) ((b) >= ' ' && (b) < 0x7F && (b) != '"' && (b) != '\\')
+
+/** Length of the run of bytes that need no escape at the start of str */
+static size_t literalRunLength(const uint8_t* str, const size_t len) {
+    size_t i = 0;
+#ifdef __AVX2__
+    const __m256i space32 = _mm256_set1_epi8(' ' - 1), del32 = _mm256_set1_epi8(0x7F);
+    const __m256i quote32 = _mm256_set1_epi8('"'), backslash32 = _mm256_set1_epi8('\\');
+    for (; i + 32 <= len; i += 32) {
+        const __m256i chunk = _mm256_loadu_si256((const __m256i*)(str + i));
+        // Signed compare, bytes from 0x80 are negative and fail it like control characters
+        const __m256i escape = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_cmpgt_epi8(chunk, space32), _mm256_setzero_si256()),
+                            _mm256_cmpeq_epi8(chunk, del32)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote32), _mm256_cmpeq_epi8(chunk, backslash32)));
+        const uint32_t mask = (uint32_t)_mm256_movemask_epi8(escape);
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+#endif
+#ifdef __SSE2__
+    const __m128i space16 = _mm_set1_epi8(' ' - 1), del16 = _mm_set1_epi8(0x7F);
+    const __m128i quote16 = _mm_set1_epi8('"'), backslash16 = _mm_set1_epi8('\\');
+    for (; i + 16 <= len; i += 16) {
+        const __m128i chunk = _mm_loadu_si128((const __m128i*)(str + i));
+        const __m128i escape = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(_mm_cmpgt_epi8(chunk, space16), _mm_setzero_si128()),
+                         _mm_cmpeq_epi8(chunk, del16)),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote16), _mm_cmpeq_epi8(chunk, backslash16)));
+        const uint32_t mask = (uint32_t)_mm_movemask_epi8(escape);
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+#endif
+    while (i < len && IS_LITERAL_BYTE(str[i]))
+        i++;
+    return i;
 }
 
 void byteBufferWriteStrUtf8(ByteBuffer* byteBuffer, const char* str) {
-    while (*str) {
-        const size_t offset = byteBuffer->len;
-        if (*str >= 0x7F || *str < ' ') {
-            byteBufferAddLen(byteBuffer, 3);
-            *(byteBuffer->buf + offset) = '\\';
-            *(byteBuffer->buf + offset + 1) = to_hex_char((*str >> 4) & 0xF);
-            *(byteBuffer->buf + offset + 2) = to_hex_char((*str) & 0xF);
-        } else {
-            byteBufferAddLen(byteBuffer, 1);
-            *(byteBuffer->buf + offset) = *str;
-        }
-        str++;
+    const size_t len = strlen(str);
+    if (!len)
+        return;
+    // Reserve for every byte escaped, so the loop below has no capacity check
+    const size_t offset = byteBuffer->len;
+    byteBufferAddLen(byteBuffer, len * 3);
+    uint8_t* out = byteBuffer->buf + offset;
+
+    const uint8_t* in = (const uint8_t*)str;
+    const uint8_t* end = in + len;
+    while (in < end) {
+        const size_t run = literalRunLength(in, end - in);
+        memcpy(out, in, run);
+        out += run;
+        in += run;
+        // CJK text is escaped byte after byte
+        for (; in < end && !IS_LITERAL_BYTE(*in); ++in, out += 3)
+            memcpy(out, escapeTable[*in], 3);
+    }
+    byteBuffer->len = out - byteBuffer->buf;
+}
+
+void byteBufferWriteFormatV(ByteBuffer* byteBuffer, const char* fmt, va_list args) {
+    const size_t offset = byteBuffer->len;
+    const size_t space = byteBuffer->bufLen - offset;
+    va_list retry;
+    va_copy(retry, args);
+    // Format into free tail, grow and format again only if it doesn't fit
+    const int len = vsnprintf(space ? (char*)byteBuffer->buf + offset : NULL, space, fmt, args);
+    if (len >= 0 && (size_t)len >= space) {
+        // One more byte for the terminator vsnprintf writes
+        byteBufferAddLen(byteBuffer, len + 1);
+        vsnprintf((char*)byteBuffer->buf + offset, len + 1, fmt, retry);
     }
+    va_end(retry);
+    byteBuffer->len = offset + (len > 0 ? len : 0);
 }
 
 void byteBufferWriteFormat(ByteBuffer* byteBuffer, char* fmt, ...) {
-    va_list ap;
-    va_start(ap, fmt);
-    string constStr = strFromFormatV(fmt, ap);
-    va_end(ap);
-    byteBufferWriteStr(byteBuffer, constStr);
-    strFree(constStr);
+    va_list args;
+    va_start(args, fmt);
+    byteBufferWriteFormatV(byteBuffer, fmt, args);
+    va_end(args);
+}
+
+void byteBufferWriteI64(ByteBuffer* byteBuffer, int64_t value) {
+    // Digits are generated from the end, 20 is enough for INT64_MIN
+    char digits[20];
+    char* end = digits + sizeof(digits);
+    char* ptr = end;
+    uint64_t abs = value < 0 ? -(uint64_t)value : (uint64_t)value;
+    do {
+        *--ptr = (char)('0' + abs % 10);
+        abs /= 10;
+    } while (abs);
+    if (value < 0)
+        *--ptr = '-';
+    byteBufferWrite(byteBuffer, (uint8_t*)ptr, end - ptr);
+}
+
+void byteBufferWriteLabel(ByteBuffer* byteBuffer, const char* prefix, int64_t index) {
+    byteBufferWrite(byteBuffer, (uint8_t*)prefix, strlen(prefix));
+    byteBufferWriteI64(byteBuffer, index);
 }
 
 void byteBufferWriteStr(ByteBuffer* byteBuffer, char* str) {
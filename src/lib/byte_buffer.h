@@ -1,5 +1,6 @@
 #ifndef BYTE_BUFFER_H
 #define BYTE_BUFFER_H
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -23,6 +24,14 @@ void byteBufferWriteStr(ByteBuffer* byteBuffer, char* str);
 
 void byteBufferWriteFormat(ByteBuffer* byteBuffer, char* fmt, ...);
 
+void byteBufferWriteFormatV(ByteBuffer* byteBuffer, const char* fmt, va_list args);
+
+// Decimal text of value
+void byteBufferWriteI64(ByteBuffer* byteBuffer, int64_t value);
+
+// prefix followed by decimal index, like "%t." and 3 for %t.3
+void byteBufferWriteLabel(ByteBuffer* byteBuffer, const char* prefix, int64_t index);
+
 void byteBufferWrite(ByteBuffer* byteBuffer, uint8_t* arr, size_t size);
 
 void byteBufferWriteToFile(ByteBuffer* byteBuffer, FILE* file);
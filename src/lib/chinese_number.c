@@ -42,168 +42,115 @@ typedef struct {
     NumberToken token;
 } TokenMapEntry;
 
-// Unified token table based on Javascript NUM_TOKENS
-static const TokenMapEntry k_token_map[] = {
-    {U'負', {TOKEN_TYPE_SIGN, {.negative = true}}},
-    {U'·', {TOKEN_TYPE_DECIMAL, {.exp = 0}}}, // U+00B7 Middle Dot
-    {U'又', {TOKEN_TYPE_DELIM, {0}}},
-    {U'有', {TOKEN_TYPE_DELIM, {0}}},
-    {U'零', {TOKEN_TYPE_ZERO, {.digit = 0}}},
-    {U'〇', {TOKEN_TYPE_DIGIT, {.digit = 0}}}, // U+3007 Ideographic Number Zero
-    {U'一', {TOKEN_TYPE_DIGIT, {.digit = 1}}},
-    {U'二', {TOKEN_TYPE_DIGIT, {.digit = 2}}},
-    {U'三', {TOKEN_TYPE_DIGIT, {.digit = 3}}},
-    {U'四', {TOKEN_TYPE_DIGIT, {.digit = 4}}},
-    {U'五', {TOKEN_TYPE_DIGIT, {.digit = 5}}},
-    {U'六', {TOKEN_TYPE_DIGIT, {.digit = 6}}},
-    {U'七', {TOKEN_TYPE_DIGIT, {.digit = 7}}},
-    {U'八', {TOKEN_TYPE_DIGIT, {.digit = 8}}},
-    {U'九', {TOKEN_TYPE_DIGIT, {.digit = 9}}},
-    {U'兩', {TOKEN_TYPE_DIGIT, {.digit = 2}}},
-    {U'十', {TOKEN_TYPE_INT_MULT, {.exp = 1}}},
-    {U'百', {TOKEN_TYPE_INT_MULT, {.exp = 2}}},
-    {U'千', {TOKEN_TYPE_INT_MULT, {.exp = 3}}},
-    {U'萬', {TOKEN_TYPE_INT_MULT, {.exp = 4}}},
-    {U'億', {TOKEN_TYPE_INT_MULT, {.exp = 8}}},
-    {U'兆', {TOKEN_TYPE_INT_MULT, {.exp = 12}}},
-    {U'京', {TOKEN_TYPE_INT_MULT, {.exp = 16}}},
-    {U'垓', {TOKEN_TYPE_INT_MULT, {.exp = 20}}},
-    {U'秭', {TOKEN_TYPE_INT_MULT, {.exp = 24}}},
-    {U'穰', {TOKEN_TYPE_INT_MULT, {.exp = 28}}},
-    {U'溝', {TOKEN_TYPE_INT_MULT, {.exp = 32}}},
-    {U'澗', {TOKEN_TYPE_INT_MULT, {.exp = 36}}},
-    {U'正', {TOKEN_TYPE_INT_MULT, {.exp = 40}}},
-    {U'載', {TOKEN_TYPE_INT_MULT, {.exp = 44}}},
-    {U'極', {TOKEN_TYPE_INT_MULT, {.exp = 48}}},
-    {U'分', {TOKEN_TYPE_FRAC_MULT, {.exp = -1}}},
-    {U'釐', {TOKEN_TYPE_FRAC_MULT, {.exp = -2}}},
-    {U'毫', {TOKEN_TYPE_FRAC_MULT, {.exp = -3}}},
-    {U'絲', {TOKEN_TYPE_FRAC_MULT, {.exp = -4}}},
-    {U'忽', {TOKEN_TYPE_FRAC_MULT, {.exp = -5}}},
-    {U'微', {TOKEN_TYPE_FRAC_MULT, {.exp = -6}}},
-    {U'纖', {TOKEN_TYPE_FRAC_MULT, {.exp = -7}}},
-    {U'沙', {TOKEN_TYPE_FRAC_MULT, {.exp = -8}}},
-    {U'塵', {TOKEN_TYPE_FRAC_MULT, {.exp = -9}}},
-    {U'埃', {TOKEN_TYPE_FRAC_MULT, {.exp = -10}}},
-    {U'渺', {TOKEN_TYPE_FRAC_MULT, {.exp = -11}}},
-    {U'漠', {TOKEN_TYPE_FRAC_MULT, {.exp = -12}}},
+// Perfect hash of every numeral code point into 128 slots, checked collision free for the table below
+#define TOKEN_HASH_BITS 7
+#define TOKEN_HASH(ch) ((uint32_t)(ch) * 0x1E6E8459u >> (32 - TOKEN_HASH_BITS))
+
+// Unified token table based on Javascript NUM_TOKENS, indexed by TOKEN_HASH
+static const TokenMapEntry k_token_map[1 << TOKEN_HASH_BITS] = {
+    [TOKEN_HASH(U'負')] = {U'負', {TOKEN_TYPE_SIGN, {.negative = true}}},
+    [TOKEN_HASH(U'·')] = {U'·', {TOKEN_TYPE_DECIMAL, {.exp = 0}}}, // U+00B7 Middle Dot
+    [TOKEN_HASH(U'又')] = {U'又', {TOKEN_TYPE_DELIM, {0}}},
+    [TOKEN_HASH(U'有')] = {U'有', {TOKEN_TYPE_DELIM, {0}}},
+    [TOKEN_HASH(U'零')] = {U'零', {TOKEN_TYPE_ZERO, {.digit = 0}}},
+    [TOKEN_HASH(U'〇')] = {U'〇', {TOKEN_TYPE_DIGIT, {.digit = 0}}}, // U+3007 Ideographic Number Zero
+    [TOKEN_HASH(U'一')] = {U'一', {TOKEN_TYPE_DIGIT, {.digit = 1}}},
+    [TOKEN_HASH(U'二')] = {U'二', {TOKEN_TYPE_DIGIT, {.digit = 2}}},
+    [TOKEN_HASH(U'三')] = {U'三', {TOKEN_TYPE_DIGIT, {.digit = 3}}},
+    [TOKEN_HASH(U'四')] = {U'四', {TOKEN_TYPE_DIGIT, {.digit = 4}}},
+    [TOKEN_HASH(U'五')] = {U'五', {TOKEN_TYPE_DIGIT, {.digit = 5}}},
+    [TOKEN_HASH(U'六')] = {U'六', {TOKEN_TYPE_DIGIT, {.digit = 6}}},
+    [TOKEN_HASH(U'七')] = {U'七', {TOKEN_TYPE_DIGIT, {.digit = 7}}},
+    [TOKEN_HASH(U'八')] = {U'八', {TOKEN_TYPE_DIGIT, {.digit = 8}}},
+    [TOKEN_HASH(U'九')] = {U'九', {TOKEN_TYPE_DIGIT, {.digit = 9}}},
+    [TOKEN_HASH(U'兩')] = {U'兩', {TOKEN_TYPE_DIGIT, {.digit = 2}}},
+    [TOKEN_HASH(U'十')] = {U'十', {TOKEN_TYPE_INT_MULT, {.exp = 1}}},
+    [TOKEN_HASH(U'百')] = {U'百', {TOKEN_TYPE_INT_MULT, {.exp = 2}}},
+    [TOKEN_HASH(U'千')] = {U'千', {TOKEN_TYPE_INT_MULT, {.exp = 3}}},
+    [TOKEN_HASH(U'萬')] = {U'萬', {TOKEN_TYPE_INT_MULT, {.exp = 4}}},
+    [TOKEN_HASH(U'億')] = {U'億', {TOKEN_TYPE_INT_MULT, {.exp = 8}}},
+    [TOKEN_HASH(U'兆')] = {U'兆', {TOKEN_TYPE_INT_MULT, {.exp = 12}}},
+    [TOKEN_HASH(U'京')] = {U'京', {TOKEN_TYPE_INT_MULT, {.exp = 16}}},
+    [TOKEN_HASH(U'垓')] = {U'垓', {TOKEN_TYPE_INT_MULT, {.exp = 20}}},
+    [TOKEN_HASH(U'秭')] = {U'秭', {TOKEN_TYPE_INT_MULT, {.exp = 24}}},
+    [TOKEN_HASH(U'穰')] = {U'穰', {TOKEN_TYPE_INT_MULT, {.exp = 28}}},
+    [TOKEN_HASH(U'溝')] = {U'溝', {TOKEN_TYPE_INT_MULT, {.exp = 32}}},
+    [TOKEN_HASH(U'澗')] = {U'澗', {TOKEN_TYPE_INT_MULT, {.exp = 36}}},
+    [TOKEN_HASH(U'正')] = {U'正', {TOKEN_TYPE_INT_MULT, {.exp = 40}}},
+    [TOKEN_HASH(U'載')] = {U'載', {TOKEN_TYPE_INT_MULT, {.exp = 44}}},
+    [TOKEN_HASH(U'極')] = {U'極', {TOKEN_TYPE_INT_MULT, {.exp = 48}}},
+    [TOKEN_HASH(U'分')] = {U'分', {TOKEN_TYPE_FRAC_MULT, {.exp = -1}}},
+    [TOKEN_HASH(U'釐')] = {U'釐', {TOKEN_TYPE_FRAC_MULT, {.exp = -2}}},
+    [TOKEN_HASH(U'毫')] = {U'毫', {TOKEN_TYPE_FRAC_MULT, {.exp = -3}}},
+    [TOKEN_HASH(U'絲')] = {U'絲', {TOKEN_TYPE_FRAC_MULT, {.exp = -4}}},
+    [TOKEN_HASH(U'忽')] = {U'忽', {TOKEN_TYPE_FRAC_MULT, {.exp = -5}}},
+    [TOKEN_HASH(U'微')] = {U'微', {TOKEN_TYPE_FRAC_MULT, {.exp = -6}}},
+    [TOKEN_HASH(U'纖')] = {U'纖', {TOKEN_TYPE_FRAC_MULT, {.exp = -7}}},
+    [TOKEN_HASH(U'沙')] = {U'沙', {TOKEN_TYPE_FRAC_MULT, {.exp = -8}}},
+    [TOKEN_HASH(U'塵')] = {U'塵', {TOKEN_TYPE_FRAC_MULT, {.exp = -9}}},
+    [TOKEN_HASH(U'埃')] = {U'埃', {TOKEN_TYPE_FRAC_MULT, {.exp = -10}}},
+    [TOKEN_HASH(U'渺')] = {U'渺', {TOKEN_TYPE_FRAC_MULT, {.exp = -11}}},
+    [TOKEN_HASH(U'漠')] = {U'漠', {TOKEN_TYPE_FRAC_MULT, {.exp = -12}}},
     // Financial digits - map to regular digits
-    {U'壹', {TOKEN_TYPE_DIGIT, {.digit = 1}}},
-    {U'貳', {TOKEN_TYPE_DIGIT, {.digit = 2}}},
-    {U'參', {TOKEN_TYPE_DIGIT, {.digit = 3}}},
-    {U'肆', {TOKEN_TYPE_DIGIT, {.digit = 4}}},
-    {U'伍', {TOKEN_TYPE_DIGIT, {.digit = 5}}},
-    {U'陸', {TOKEN_TYPE_DIGIT, {.digit = 6}}},
-    {U'柒', {TOKEN_TYPE_DIGIT, {.digit = 7}}},
-    {U'捌', {TOKEN_TYPE_DIGIT, {.digit = 8}}},
-    {U'玖', {TOKEN_TYPE_DIGIT, {.digit = 9}}},
+    [TOKEN_HASH(U'壹')] = {U'壹', {TOKEN_TYPE_DIGIT, {.digit = 1}}},
+    [TOKEN_HASH(U'貳')] = {U'貳', {TOKEN_TYPE_DIGIT, {.digit = 2}}},
+    [TOKEN_HASH(U'參')] = {U'參', {TOKEN_TYPE_DIGIT, {.digit = 3}}},
+    [TOKEN_HASH(U'肆')] = {U'肆', {TOKEN_TYPE_DIGIT, {.digit = 4}}},
+    [TOKEN_HASH(U'伍')] = {U'伍', {TOKEN_TYPE_DIGIT, {.digit = 5}}},
+    [TOKEN_HASH(U'陸')] = {U'陸', {TOKEN_TYPE_DIGIT, {.digit = 6}}},
+    [TOKEN_HASH(U'柒')] = {U'柒', {TOKEN_TYPE_DIGIT, {.digit = 7}}},
+    [TOKEN_HASH(U'捌')] = {U'捌', {TOKEN_TYPE_DIGIT, {.digit = 8}}},
+    [TOKEN_HASH(U'玖')] = {U'玖', {TOKEN_TYPE_DIGIT, {.digit = 9}}},
     // Financial units - map to regular units
-    {U'拾', {TOKEN_TYPE_INT_MULT, {.exp = 1}}},
-    {U'佰', {TOKEN_TYPE_INT_MULT, {.exp = 2}}},
-    {U'仟', {TOKEN_TYPE_INT_MULT, {.exp = 3}}},
+    [TOKEN_HASH(U'拾')] = {U'拾', {TOKEN_TYPE_INT_MULT, {.exp = 1}}},
+    [TOKEN_HASH(U'佰')] = {U'佰', {TOKEN_TYPE_INT_MULT, {.exp = 2}}},
+    [TOKEN_HASH(U'仟')] = {U'仟', {TOKEN_TYPE_INT_MULT, {.exp = 3}}},
 };
 
 static NumberToken lookup_token(const char32_t ch) {
-    for (size_t i = 0; i < sizeof k_token_map / sizeof *k_token_map; ++i) {
-        if (k_token_map[i].ch == ch) return k_token_map[i].token;
-    }
+    const TokenMapEntry* entry = &k_token_map[TOKEN_HASH(ch)];
+    if (entry->ch == ch && ch != 0) return entry->token;
     return (NumberToken){TOKEN_TYPE_UNKNOWN};
 }
 
-/* ---------- very small UTF-8 → UTF-32 decoder --------------------------- */
-/* returns number of codepoints written to out; -1 on error */
-/* (modified slightly to handle potential allocation failures more gracefully) */
-static int utf8_to_u32(const char* s, char32_t** out_buf) {
-    size_t cap = 32, len = 0;
-    if (!s) return -1;
-    char32_t* out = malloc(cap * sizeof *out);
-    if (!out) return -1;
+/* ---------- Tokenizer ---------------------------------------------------- */
+/* Decode UTF-8 straight into tokens, every numeral character is 2 (·) or 3 bytes long */
+/* returns number of tokens written including BEGIN and END; 0 on invalid UTF-8 or unknown character */
+static size_t tokenize(const char* utf8, NumberToken* tokens) {
+    const unsigned char* p = (const unsigned char*)utf8;
+    size_t count = 0;
+    tokens[count++] = (NumberToken){TOKEN_TYPE_BEGIN};
 
-    const unsigned char* p = (const unsigned char*)s;
     while (*p) {
-        uint32_t cp = 0;
-        size_t more = 0;
-
-        if (*p < 0x80) { cp = *p++; } else if ((*p & 0xE0) == 0xC0 && p[1]) {
-            cp = *p & 0x1F;
-            more = 1;
-        } else if ((*p & 0xF0) == 0xE0 && p[1] && p[2]) {
-            cp = *p & 0x0F;
-            more = 2;
-        } else if ((*p & 0xF8) == 0xF0 && p[1] && p[2] && p[3]) {
-            cp = *p & 0x07;
-            more = 3;
+        char32_t cp;
+        if ((p[0] & 0xE0) == 0xC0 && (p[1] & 0xC0) == 0x80) {
+            cp = (p[0] & 0x1F) << 6 | (p[1] & 0x3F);
+            p += 2;
+        } else if ((p[0] & 0xF0) == 0xE0 && (p[1] & 0xC0) == 0x80 && (p[2] & 0xC0) == 0x80) {
+            cp = (p[0] & 0x0F) << 12 | (p[1] & 0x3F) << 6 | (p[2] & 0x3F);
+            p += 3;
+            // Overlong encoding, E0 82 B7 must not be read as ·
+            if (cp < 0x800) return 0;
         } else {
-            free(out);
-            return -1;
-        } /* invalid leading byte or truncated sequence */
-
-        p++; // Move past the first byte
-        for (size_t i = 0; i < more; ++i) {
-            if ((p[i] & 0xC0) != 0x80) {
-                free(out);
-                return -1;
-            } // Invalid continuation byte
-            cp = (cp << 6) | (p[i] & 0x3F);
-        }
-        p += more; // Move past continuation bytes
-
-        // Check for overlong encodings or invalid code points (optional but good practice)
-        if ((more == 1 && cp < 0x80) ||
-            (more == 2 && cp < 0x800) ||
-            (more == 3 && cp < 0x10000) ||
-            (cp >= 0xD800 && cp <= 0xDFFF) || // Surrogates
-            cp > 0x10FFFF) {
-            // Out of Unicode range
-            free(out);
-            return -1;
-        }
-
-
-        if (len == cap) {
-            cap *= 2;
-            // Check for potential overflow if cap becomes huge
-            if (cap < len || cap > SIZE_MAX / sizeof(*out)) {
-                free(out);
-                return -1;
-            }
-            char32_t* next_out = realloc(out, cap * sizeof *out);
-            if (!next_out) {
-                free(out);
-                return -1;
-            }
-            out = next_out;
+            // ASCII, 4 byte sequence or invalid UTF-8, none of them is a numeral
+#ifdef VERBOSE
+            fprintf(stderr, "Error: Invalid or unknown character in input.\n");
+#endif
+            return 0;
         }
-        out[len++] = (char32_t)cp;
-    }
-    *out_buf = out;
-    return (int)len;
-}
-
-/* ---------- Tokenizer ---------------------------------------------------- */
-static NumberToken* tokenize(const char32_t* code, size_t len, size_t* token_count) {
-    // Allocate space for tokens + BEGIN + END
-    NumberToken* tokens = malloc((len + 2) * sizeof(NumberToken));
-    if (!tokens) return NULL;
-
-    size_t count = 0;
-    tokens[count++] = (NumberToken){TOKEN_TYPE_BEGIN};
 
-    for (size_t i = 0; i < len; ++i) {
-        const NumberToken t = lookup_token(code[i]);
+        const NumberToken t = lookup_token(cp);
         if (t.type == TOKEN_TYPE_UNKNOWN) {
 #ifdef VERBOSE
-            fprintf(stderr, "Error: Unknown character U+%04X in input.\n", code[i]);
+            fprintf(stderr, "Error: Unknown character U+%04X in input.\n", cp);
 #endif
-            free(tokens);
-            return NULL; // Error on unknown character
+            return 0; // Error on unknown character
         }
         tokens[count++] = t;
     }
 
     tokens[count++] = (NumberToken){TOKEN_TYPE_END};
-    *token_count = count;
-    return tokens;
+    return count;
 }
 
 /* ---------- Parser State & Helpers -------------------------------------- */
@@ -229,8 +176,10 @@ typedef enum {
     MULT_STATE_DONE // Stack has been marked done (contains only infinity)
 } MultState;
 
-#define MULT_STACK_INITIAL_CAP 8
-#define RESULT_DIGITS_INITIAL_CAP 32
+// Inline capacities cover any practical literal, only longer ones move to the heap
+#define NUMBER_INLINE_TOKENS 64
+#define MULT_STACK_INLINE_CAP 16
+#define RESULT_DIGITS_INLINE_CAP 128
 #define EXP_INFINITY INT_MAX // Use INT_MAX to represent infinity state in stack
 
 // Multiplier stack structure
@@ -239,6 +188,7 @@ typedef struct {
     size_t count;
     size_t capacity;
     int total_exp_add; // Sum of exponents currently in stack
+    bool allocated; // exps is on the heap instead of caller's inline buffer
 } MultStack;
 
 // Intermediate parse result structure
@@ -248,21 +198,37 @@ typedef struct {
     uint8_t* digits; // Array of digits (0-9), lowest to highest significance
     int count; // Number of digits currently stored
     size_t capacity; // Allocated capacity of digits array
+    bool allocated; // digits is on the heap instead of caller's inline buffer
 } ParseResult;
 
-// Helper: Initialize multiplier stack
-static bool mult_stack_init(MultStack* stack) {
-    stack->exps = malloc(MULT_STACK_INITIAL_CAP * sizeof(int));
-    if (!stack->exps) return false;
+// Helper: Grow inline or heap array to twice the capacity
+static void* array_grow(void* data, size_t* capacity, bool* allocated, size_t elementSize) {
+    const size_t new_capacity = *capacity * 2;
+    if (new_capacity < *capacity || new_capacity > SIZE_MAX / elementSize) return NULL; // Overflow check
+    void* new_data;
+    if (*allocated) {
+        new_data = realloc(data, new_capacity * elementSize);
+    } else if ((new_data = malloc(new_capacity * elementSize))) {
+        memcpy(new_data, data, *capacity * elementSize);
+    }
+    if (!new_data) return NULL;
+    *capacity = new_capacity;
+    *allocated = true;
+    return new_data;
+}
+
+// Helper: Initialize multiplier stack on inline buffer
+static void mult_stack_init(MultStack* stack, int* buffer, size_t capacity) {
+    stack->exps = buffer;
     stack->count = 0;
-    stack->capacity = MULT_STACK_INITIAL_CAP;
+    stack->capacity = capacity;
     stack->total_exp_add = 0;
-    return true;
+    stack->allocated = false;
 }
 
 // Helper: Free multiplier stack
 static void mult_stack_free(MultStack* stack) {
-    free(stack->exps);
+    if (stack->allocated) free(stack->exps);
     stack->exps = NULL;
     stack->count = 0;
     stack->capacity = 0;
@@ -272,12 +238,9 @@ static void mult_stack_free(MultStack* stack) {
 // Helper: Push exponent onto multiplier stack
 static bool mult_stack_push(MultStack* stack, int exp) {
     if (stack->count == stack->capacity) {
-        size_t new_capacity = stack->capacity > 0 ? stack->capacity * 2 : MULT_STACK_INITIAL_CAP;
-        if (new_capacity < stack->capacity || new_capacity > SIZE_MAX / sizeof(int)) return false; // Overflow check
-        int* new_exps = realloc(stack->exps, new_capacity * sizeof(int));
+        int* new_exps = array_grow(stack->exps, &stack->capacity, &stack->allocated, sizeof(int));
         if (!new_exps) return false;
         stack->exps = new_exps;
-        stack->capacity = new_capacity;
     }
     stack->exps[stack->count++] = exp;
     if (exp != EXP_INFINITY) {
@@ -327,20 +290,19 @@ static MultState mult_stack_state(const MultStack* stack) {
     return MULT_STATE_INT;
 }
 
-// Helper: Initialize parse result
-static bool result_init(ParseResult* result) {
-    result->digits = malloc(RESULT_DIGITS_INITIAL_CAP * sizeof(uint8_t));
-    if (!result->digits) return false;
+// Helper: Initialize parse result on inline buffer
+static void result_init(ParseResult* result, uint8_t* buffer, size_t capacity) {
+    result->digits = buffer;
     result->negative = false;
     result->exp = 0; // Tracks exponent of lowest digit place added so far
     result->count = 0;
-    result->capacity = RESULT_DIGITS_INITIAL_CAP;
-    return true;
+    result->capacity = capacity;
+    result->allocated = false;
 }
 
 // Helper: Free parse result
 static void result_free(ParseResult* result) {
-    free(result->digits);
+    if (result->allocated) free(result->digits);
     result->digits = NULL;
     result->count = 0;
     result->capacity = 0;
@@ -349,13 +311,9 @@ static void result_free(ParseResult* result) {
 // Helper: Push a single digit onto result
 static bool result_push_digit(ParseResult* result, const char digit) {
     if (result->count == result->capacity) {
-        const size_t new_capacity = result->capacity > 0 ? result->capacity * 2 : RESULT_DIGITS_INITIAL_CAP;
-        if (new_capacity < result->capacity || new_capacity > SIZE_MAX / sizeof(uint8_t)) return false;
-        // Overflow check
-        char* new_digits = realloc(result->digits, new_capacity * sizeof(uint8_t));
+        uint8_t* new_digits = array_grow(result->digits, &result->capacity, &result->allocated, sizeof(uint8_t));
         if (!new_digits) return false;
         result->digits = new_digits;
-        result->capacity = new_capacity;
     }
     result->digits[result->count++] = digit;
     result->exp++;
@@ -375,12 +333,9 @@ static void result_reset_exp(ParseResult* result, int new_exp) {
 /* ---------- Core Parser (based on JS 'parse') --------------------------- */
 static uint8_t parse_tokens(const NumberToken* tokens, size_t token_count, ParseResult* result) {
     DigitState digit_state = DIGIT_STATE_NONE;
+    int stackBuffer[MULT_STACK_INLINE_CAP];
     MultStack stack;
-
-    if (!result || !mult_stack_init(&stack) || !result_init(result)) {
-        mult_stack_free(&stack); // Free stack if init failed after result alloc
-        return 1;
-    }
+    mult_stack_init(&stack, stackBuffer, MULT_STACK_INLINE_CAP);
 
     // Parse backwards, skipping END token (index token_count - 1)
     // Stop before BEGIN token (index 0)
@@ -950,14 +905,17 @@ char* sciToStr(const ScientificNotation* sci) {
             int expLen = (int)log10(exp < 0 ? -exp : exp) + 1;
             if (expLen < 2) expLen = 2;
 
-            ptr = str = malloc((neg + extraFrac + sci->fractionLen + 3 + expLen + 1) * sizeof(char));
+            ptr = str = malloc((neg + 2 + sci->fractionLen + 3 + expLen + 1) * sizeof(char));
             if (neg) *ptr++ = '-';
 
             *ptr++ = *cache;
+            *ptr++ = '.';
             if (extraFrac) {
-                *ptr++ = '.';
                 memcpy(ptr, cache + 1, sci->fractionLen);
                 ptr += sci->fractionLen - 1;
+            } else {
+                // LLVM needs a decimal point in floating literal: 1e+16 -> 1.0e+16
+                *ptr++ = '0';
             }
 
             *ptr++ = 'e';
@@ -974,6 +932,95 @@ char* sciToStr(const ScientificNotation* sci) {
     return NULL;
 }
 
+/* ---------- Constant folding ------------------------------------------- */
+static bool sci_scale_up(int64_t* fraction, int times) {
+    while (times-- > 0) {
+        if (__builtin_mul_overflow(*fraction, 10, fraction))
+            return true;
+    }
+    return false;
+}
+
+static double sci_parse_double(const ScientificNotation* sci) {
+    // Parse like LLVM does, so the value matches the emitted literal
+    char* str = sciToStr(sci);
+    const double value = strtod(str, NULL);
+    free(str);
+    return value;
+}
+
+bool sciArithmetic(const char op, const ScientificNotation* a, const ScientificNotation* b,
+                   ScientificNotation* sciOut) {
+    if (a->type == ERROR || b->type == ERROR || a->type != b->type)
+        return true;
+    const bool isFloat = a->type == F64;
+
+    // Align both operands to the lower exponent
+    int64_t aFraction = a->fraction, bFraction = b->fraction, fraction;
+    int exp = a->exp < b->exp ? a->exp : b->exp;
+    if (sci_scale_up(&aFraction, a->exp - exp) || sci_scale_up(&bFraction, b->exp - exp))
+        return true;
+
+    switch (op) {
+    case '+':
+        if (__builtin_add_overflow(aFraction, bFraction, &fraction)) return true;
+        break;
+    case '-':
+        if (__builtin_sub_overflow(aFraction, bFraction, &fraction)) return true;
+        break;
+    case '*':
+        if (__builtin_mul_overflow(a->fraction, b->fraction, &fraction)) return true;
+        exp = a->exp + b->exp;
+        break;
+    case '/':
+        if (bFraction == 0 || (aFraction == INT64_MIN && bFraction == -1)) return true;
+        // Integer division is only folded when exact, float division until the decimal terminates
+        exp = 0;
+        while (aFraction % bFraction != 0) {
+            if (!isFloat || sci_scale_up(&aFraction, 1)) return true;
+            --exp;
+        }
+        fraction = aFraction / bFraction;
+        break;
+    default:
+        return true;
+    }
+
+    if (fraction == 0) {
+        *sciOut = (ScientificNotation){a->type, 0, 1, 0};
+        return false;
+    }
+
+    // Classify the result with the same I32 -> I64 -> F64 rules as parsed literals
+    uint8_t digits[20];
+    ParseResult result = {fraction < 0, exp, digits, 0, sizeof(digits)};
+    uint64_t magnitude = fraction < 0 ? -(uint64_t)fraction : (uint64_t)fraction;
+    while (magnitude) {
+        digits[result.count++] = magnitude % 10;
+        magnitude /= 10;
+    }
+    result_to_sci(&result, sciOut);
+
+    // Never demote below operand type
+    if (sciOut->type < a->type)
+        sciOut->type = a->type;
+
+    // Double result must be the same as runtime computation
+    if (isFloat) {
+        const double aValue = sci_parse_double(a), bValue = sci_parse_double(b);
+        double value;
+        switch (op) {
+        case '+': value = aValue + bValue; break;
+        case '-': value = aValue - bValue; break;
+        case '*': value = aValue * bValue; break;
+        default: value = aValue / bValue; break;
+        }
+        if (value != sci_parse_double(sciOut))
+            return true;
+    }
+    return false;
+}
+
 double sciToDouble(const ScientificNotation* sci) {
     if (sci->type == ERROR) return NAN;
 
@@ -987,37 +1034,30 @@ double sciToDouble(const ScientificNotation* sci) {
 
 /* ---------- Main Converter (Revised) ----------------------------------- */
 bool chineseToArabic(const char* utf8, ScientificNotation* sciOut) {
-    char32_t* code = NULL;
-    int len = 0;
-    size_t token_count = 0;
-
-    // Convert UTF8 to UTF32
-    if ((len = utf8_to_u32(utf8, &code)) < 0) {
-#ifdef VERBOSE
-        fprintf(stderr, "Error: Invalid UTF-8 input.\n");
-#endif
-        sciOut->type = ERROR;
-        return true;
-    }
-    if (len == 0) {
-        free(code);
+    // Every numeral character takes at least 2 bytes, plus BEGIN and END
+    const size_t max_tokens = strlen(utf8) / 2 + 2;
+    NumberToken tokenBuffer[NUMBER_INLINE_TOKENS];
+    NumberToken* tokens = max_tokens <= NUMBER_INLINE_TOKENS ? tokenBuffer : malloc(max_tokens * sizeof(NumberToken));
+    if (!tokens) {
         sciOut->type = ERROR;
         return true;
     }
 
-    // Tokenize the UTF32 string
-    NumberToken* tokens = tokenize(code, len, &token_count);
-    free(code); // Free UTF32 buffer now
-    if (!tokens) {
-        // Error message printed by tokenize
+    // Tokenize the UTF8 string
+    const size_t token_count = tokenize(utf8, tokens);
+    // Only BEGIN and END, empty input
+    if (token_count <= 2) {
+        if (tokens != tokenBuffer) free(tokens);
         sciOut->type = ERROR;
         return true;
     }
 
     // Parse the tokens
-    ParseResult result; // Allocate result structure
+    uint8_t digitBuffer[RESULT_DIGITS_INLINE_CAP];
+    ParseResult result;
+    result_init(&result, digitBuffer, RESULT_DIGITS_INLINE_CAP);
     const uint8_t error = parse_tokens(tokens, token_count, &result);
-    free(tokens); // Free token array now
+    if (tokens != tokenBuffer) free(tokens);
     if (error) {
         // Error message printed by parse_tokens
         sciOut->type = ERROR;
@@ -24,4 +24,8 @@ bool chineseToArabic(const char* utf8, ScientificNotation* sciOut);
 char* sciToStr(const ScientificNotation* sci);
 double sciToDouble(const ScientificNotation* sci);
 
+// Fold arithmetic (+ - * /) on two number literals of the same type
+// Return true if the result can't be represented exactly
+bool sciArithmetic(char op, const ScientificNotation* a, const ScientificNotation* b, ScientificNotation* sciOut);
+
 #endif //CHINESE_NUMBER_H
@@ -9,14 +9,14 @@ void dumpScope();
 
 Object object_createStr(char* str);
 Object object_createNumber(const ScientificNotation* number);
-Object object_findIdentByName(char* name);
+Object object_findIdentByName(const char* name);
 
 bool object_VariableDefineCountCheck(const ScientificNotation* count);
 
 bool object_VariableDefineCheck(Object* count);
 
 bool code_stdoutPrint(ValueData* valueData, bool newLine);
-bool code_createVariable(ValueData* valueData, char* name);
+bool code_createVariable(ValueData* valueData, const char* name);
 bool code_assign(Object* dest, Object* src);
 Object code_expression(char op, bool op_left, Object* a, Object* b);
 
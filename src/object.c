@@ -14,6 +14,11 @@ const char* objectType2llvmType[] = {
     [OBJECT_TYPE_I64] = "i64",
     [OBJECT_TYPE_F64] = "double",
 };
+const uint8_t objectType2llvmSize[] = {
+    [OBJECT_TYPE_I32] = 4,
+    [OBJECT_TYPE_I64] = 8,
+    [OBJECT_TYPE_F64] = 8,
+};
 const char* objectType2strFormat[] = {
     [OBJECT_TYPE_I32] = "%d",
     [OBJECT_TYPE_I64] = "%lld",
@@ -27,4 +32,10 @@ const char* objectType2str[] = {
     [OBJECT_TYPE_STR] = "字串",
     [OBJECT_TYPE_IDENT] = "識名",
     [OBJECT_TYPE_UNDEFINED] = "無定",
-};
\ No newline at end of file
+};
+
+ObjectType getObjectType(const Object* obj) {
+    if (obj->type == OBJECT_TYPE_IDENT)
+        return obj->symbol->type;
+    return obj->type;
+}
@@ -26,24 +26,35 @@ typedef enum {
 
 typedef struct {
     ObjectType type;
-    char* name;
+    // Interned name
+    const char* name;
     int32_t index;
+    // Expression result, held in SSA value %t.index instead of variable %var.index
     bool expCache;
 } SymbolData;
 
+/**
+ * Value held by the parser, type selects the member in use:
+ * str for OBJECT_TYPE_STR, symbol for OBJECT_TYPE_IDENT and number for number literals
+ */
 typedef struct {
     ObjectType type;
-    // uint32_t array;
-    char* str;
-    ScientificNotation* number;
-    // uint8_t flag;
-    SymbolData* symbol;
-    // LinkedList* arraySubscript;
+    union {
+        char* str;
+        // Number literal is kept in place
+        ScientificNotation number;
+        // Symbol table entry or expression cache in frontendArena
+        SymbolData* symbol;
+    };
 } Object;
 
 extern const ObjectType numberType2objectType[];
 extern const char* objectType2llvmType[];
+extern const uint8_t objectType2llvmSize[];
 extern const char* objectType2strFormat[];
 extern const char* objectType2str[];
 
+/** Type of the object value, identifier resolves to its symbol type */
+ObjectType getObjectType(const Object* obj);
+
 #endif //WENYAN_LLVM_OBJECT_H
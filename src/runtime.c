@@ -0,0 +1,304 @@
+#include "runtime.h"
+
+#define STR_(x) #x
+#define STR(x) STR_(x)
+
+#ifdef WIN32
+#define RUNTIME_WRITE_DECLARE "declare i32 @_write(i32, ptr, i32)\n"
+#define RUNTIME_WRITE_CALL                                      \
+    "    %rest.i32 = trunc i64 %rest to i32\n"                  \
+    "    %n.i32 = call i32 @_write(i32 1, ptr %ptr, i32 %rest.i32)\n" \
+    "    %n = sext i32 %n.i32 to i64\n"
+// Enable windows cmd utf8 output
+#define RUNTIME_INIT                                            \
+    "declare dllimport i32 @_setmode(i32, i32)\n"                \
+    "declare dllimport i32 @SetConsoleCP(i32)\n"                 \
+    "declare dllimport i32 @SetConsoleOutputCP(i32)\n"           \
+    "define internal void @wy_init() {\n"                        \
+    "    %1 = call i32 @_setmode(i32 0, i32 32768)\n"            \
+    "    %2 = call i32 @_setmode(i32 1, i32 32768)\n"            \
+    "    %3 = call i32 @SetConsoleCP(i32 65001)\n"               \
+    "    %4 = call i32 @SetConsoleOutputCP(i32 65001)\n"         \
+    "    ret void\n"                                             \
+    "}\n"
+#else
+#define RUNTIME_WRITE_DECLARE "declare i64 @write(i32, ptr, i64)\n"
+#define RUNTIME_WRITE_CALL                                      \
+    "    %n = call i64 @write(i32 1, ptr %ptr, i64 %rest)\n"
+#define RUNTIME_INIT                                            \
+    "define internal void @wy_init() {\n"                        \
+    "    ret void\n"                                             \
+    "}\n"
+#endif
+
+// Format number into stdout buffer with @wy_fmt_<type>, then append newline if needed
+#define RUNTIME_PRINT_NUMBER(type)                                                      \
+    "define internal void @wy_print_" #type "(" #type " %value, i1 %newLine) {\n"        \
+    "entry:\n"                                                                          \
+    "    %len = load i64, ptr @wy.out.len\n"                                            \
+    "    %end = add i64 %len, " STR(RUNTIME_NUMBER_BUFFER_SIZE) "\n"                    \
+    "    %fit = icmp ule i64 %end, " STR(RUNTIME_OUTPUT_BUFFER_SIZE) "\n"               \
+    "    br i1 %fit, label %print, label %flush\n"                                      \
+    "flush:\n"                                                                          \
+    "    call void @wy_flush()\n"                                                       \
+    "    br label %print\n"                                                             \
+    "print:\n"                                                                          \
+    "    %offset = phi i64 [%len, %entry], [0, %flush]\n"                               \
+    "    %dest = getelementptr inbounds i8, ptr @wy.out.buf, i64 %offset\n"             \
+    "    %n = call i64 @wy_fmt_" #type "(" #type " %value, ptr %dest)\n"                \
+    "    %newLen = add i64 %offset, %n\n"                                               \
+    "    br i1 %newLine, label %line, label %done\n"                                    \
+    "line:\n"                                                                           \
+    "    %lf = getelementptr inbounds i8, ptr @wy.out.buf, i64 %newLen\n"               \
+    "    store i8 10, ptr %lf\n"                                                        \
+    "    %newLen.lf = add i64 %newLen, 1\n"                                             \
+    "    br label %done\n"                                                              \
+    "done:\n"                                                                           \
+    "    %total = phi i64 [%newLen, %print], [%newLen.lf, %line]\n"                     \
+    "    store i64 %total, ptr @wy.out.len\n"                                           \
+    "    ret void\n"                                                                    \
+    "}\n"
+
+// Write the lowest 2 digits of %v from digit pair table to %tmp[%pos]
+#define RUNTIME_WRITE_PAIR(v, pos)                                                      \
+    "    %" #v ".pair = shl i64 %" #v ", 1\n"                                           \
+    "    %" #v ".src = getelementptr inbounds i8, ptr @wy.digitPairs, i64 %" #v ".pair\n" \
+    "    %" #v ".dst = getelementptr inbounds i8, ptr %tmp, i64 %" #pos "\n"            \
+    "    call void @llvm.memcpy.p0.p0.i64(ptr %" #v ".dst, ptr %" #v ".src, i64 2, i1 false)\n"
+
+const char runtimeSource[] =
+    "; ---------- wenyan runtime ----------\n"
+    RUNTIME_WRITE_DECLARE
+    "declare i32 @snprintf(ptr, i64, ptr, ...)\n"
+    "declare double @strtod(ptr, ptr)\n"
+    "declare double @llvm.round.f64(double)\n"
+    "declare double @llvm.fabs.f64(double)\n"
+    "declare void @llvm.memset.p0.i64(ptr nocapture writeonly, i8, i64, i1 immarg)\n"
+    "declare void @llvm.memcpy.p0.p0.i64(ptr noalias nocapture writeonly, ptr noalias nocapture readonly, i64, i1 immarg)\n"
+    "declare void @llvm.lifetime.start.p0(i64 immarg, ptr nocapture)\n"
+    "declare void @llvm.lifetime.end.p0(i64 immarg, ptr nocapture)\n"
+    "\n"
+    RUNTIME_INIT
+    "\n"
+    "@wy.out.buf = internal global [" STR(RUNTIME_OUTPUT_BUFFER_SIZE) " x i8] zeroinitializer\n"
+    "@wy.out.len = internal global i64 0\n"
+    "@wy.digitPairs = internal unnamed_addr constant [200 x i8] c\""
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899\"\n"
+    "@wy.str.nan = internal unnamed_addr constant [3 x i8] c\"nan\"\n"
+    "@wy.str.inf = internal unnamed_addr constant [3 x i8] c\"inf\"\n"
+    "@wy.fmt.g = internal unnamed_addr constant [5 x i8] c\"%.*g\\00\"\n"
+    "\n"
+    // Write all bytes to fd 1, retry on partial write
+    "define internal void @wy_writeFd(ptr %data, i64 %size) {\n"
+    "entry:\n"
+    "    br label %loop\n"
+    "loop:\n"
+    "    %done = phi i64 [0, %entry], [%done.next, %write]\n"
+    "    %more = icmp ult i64 %done, %size\n"
+    "    br i1 %more, label %write, label %exit\n"
+    "write:\n"
+    "    %ptr = getelementptr inbounds i8, ptr %data, i64 %done\n"
+    "    %rest = sub i64 %size, %done\n"
+    RUNTIME_WRITE_CALL
+    "    %done.next = add i64 %done, %n\n"
+    "    %ok = icmp sgt i64 %n, 0\n"
+    "    br i1 %ok, label %loop, label %exit\n"
+    "exit:\n"
+    "    ret void\n"
+    "}\n"
+    "\n"
+    "define internal void @wy_flush() {\n"
+    "    %len = load i64, ptr @wy.out.len\n"
+    "    call void @wy_writeFd(ptr @wy.out.buf, i64 %len)\n"
+    "    store i64 0, ptr @wy.out.len\n"
+    "    ret void\n"
+    "}\n"
+    "\n"
+    "define internal void @wy_write(ptr %data, i64 %size) {\n"
+    "entry:\n"
+    "    %len = load i64, ptr @wy.out.len\n"
+    "    %end = add i64 %len, %size\n"
+    "    %fit = icmp ule i64 %end, " STR(RUNTIME_OUTPUT_BUFFER_SIZE) "\n"
+    "    br i1 %fit, label %copy, label %flush\n"
+    "flush:\n"
+    "    call void @wy_flush()\n"
+    "    %large = icmp ugt i64 %size, " STR(RUNTIME_OUTPUT_BUFFER_SIZE) "\n"
+    "    br i1 %large, label %direct, label %copy\n"
+    "direct:\n"
+    "    call void @wy_writeFd(ptr %data, i64 %size)\n"
+    "    ret void\n"
+    "copy:\n"
+    "    %offset = phi i64 [%len, %entry], [0, %flush]\n"
+    "    %dest = getelementptr inbounds i8, ptr @wy.out.buf, i64 %offset\n"
+    "    call void @llvm.memcpy.p0.p0.i64(ptr %dest, ptr %data, i64 %size, i1 false)\n"
+    "    %newLen = add i64 %offset, %size\n"
+    "    store i64 %newLen, ptr @wy.out.len\n"
+    "    ret void\n"
+    "}\n"
+    "\n"
+    // Unsigned integer to decimal, two digits per step from the digit pair table. Return length
+    "define internal i64 @wy_fmt_u64(i64 %value, ptr %buf) {\n"
+    "entry:\n"
+    "    %tmp = alloca [20 x i8]\n"
+    "    br label %pairs\n"
+    "pairs:\n"
+    "    %v = phi i64 [%value, %entry], [%q, %pairs.body]\n"
+    "    %pos = phi i64 [20, %entry], [%pos.next, %pairs.body]\n"
+    "    %big = icmp uge i64 %v, 100\n"
+    "    br i1 %big, label %pairs.body, label %tail\n"
+    "pairs.body:\n"
+    "    %q = udiv i64 %v, 100\n"
+    "    %q.100 = mul i64 %q, 100\n"
+    "    %r = sub i64 %v, %q.100\n"
+    "    %pos.next = sub i64 %pos, 2\n"
+    RUNTIME_WRITE_PAIR(r, pos.next)
+    "    br label %pairs\n"
+    "tail:\n"
+    "    %two = icmp uge i64 %v, 10\n"
+    "    br i1 %two, label %tail.two, label %tail.one\n"
+    "tail.two:\n"
+    "    %pos.two = sub i64 %pos, 2\n"
+    RUNTIME_WRITE_PAIR(v, pos.two)
+    "    br label %copy\n"
+    "tail.one:\n"
+    "    %pos.one = sub i64 %pos, 1\n"
+    "    %v.i8 = trunc i64 %v to i8\n"
+    "    %digit = add i8 %v.i8, 48\n"
+    "    %digit.dst = getelementptr inbounds i8, ptr %tmp, i64 %pos.one\n"
+    "    store i8 %digit, ptr %digit.dst\n"
+    "    br label %copy\n"
+    "copy:\n"
+    "    %start = phi i64 [%pos.two, %tail.two], [%pos.one, %tail.one]\n"
+    "    %length = sub i64 20, %start\n"
+    "    %from = getelementptr inbounds i8, ptr %tmp, i64 %start\n"
+    "    call void @llvm.memcpy.p0.p0.i64(ptr %buf, ptr %from, i64 %length, i1 false)\n"
+    "    ret i64 %length\n"
+    "}\n"
+    "\n"
+    "define internal i64 @wy_fmt_i64(i64 %value, ptr %buf) {\n"
+    "entry:\n"
+    "    %neg = icmp slt i64 %value, 0\n"
+    "    br i1 %neg, label %negative, label %positive\n"
+    "positive:\n"
+    "    %length = call i64 @wy_fmt_u64(i64 %value, ptr %buf)\n"
+    "    ret i64 %length\n"
+    "negative:\n"
+    "    store i8 45, ptr %buf\n"
+    "    %abs = sub i64 0, %value\n"
+    "    %digits = getelementptr inbounds i8, ptr %buf, i64 1\n"
+    "    %length.abs = call i64 @wy_fmt_u64(i64 %abs, ptr %digits)\n"
+    "    %length.neg = add i64 %length.abs, 1\n"
+    "    ret i64 %length.neg\n"
+    "}\n"
+    "\n"
+    "define internal i64 @wy_fmt_i32(i32 %value, ptr %buf) {\n"
+    "    %value.i64 = sext i32 %value to i64\n"
+    "    %length = tail call i64 @wy_fmt_i64(i64 %value.i64, ptr %buf)\n"
+    "    ret i64 %length\n"
+    "}\n"
+    "\n"
+    // Shortest decimal that parses back to the same double.
+    // Fast path: smallest d that round(|value| * 10^d) / 10^d == |value|, with both operands exact,
+    // the division is correctly rounded just like strtod. Otherwise take the first of %.15g %.16g %.17g
+    // that round-trips
+    "define internal i64 @wy_fmt_double(double %value, ptr %buf) {\n"
+    "entry:\n"
+    "    %digits = alloca [20 x i8]\n"
+    "    %nan = fcmp uno double %value, %value\n"
+    "    br i1 %nan, label %nan.str, label %sign\n"
+    "nan.str:\n"
+    "    call void @llvm.memcpy.p0.p0.i64(ptr %buf, ptr @wy.str.nan, i64 3, i1 false)\n"
+    "    ret i64 3\n"
+    "sign:\n"
+    "    %neg = fcmp olt double %value, 0.0\n"
+    "    %abs = call double @llvm.fabs.f64(double %value)\n"
+    "    %signLen = zext i1 %neg to i64\n"
+    "    %out = getelementptr inbounds i8, ptr %buf, i64 %signLen\n"
+    "    store i8 45, ptr %buf\n"
+    "    %inf = fcmp oeq double %abs, 0x7FF0000000000000\n"
+    "    br i1 %inf, label %inf.str, label %fast\n"
+    "inf.str:\n"
+    "    call void @llvm.memcpy.p0.p0.i64(ptr %out, ptr @wy.str.inf, i64 3, i1 false)\n"
+    "    %inf.len = add i64 %signLen, 3\n"
+    "    ret i64 %inf.len\n"
+    "fast:\n"
+    "    %small = fcmp olt double %abs, 0x4340000000000000\n"
+    "    br i1 %small, label %try, label %slow\n"
+    "try:\n"
+    "    %d = phi i64 [0, %fast], [%d.next, %try.next]\n"
+    "    %scale = phi double [1.0, %fast], [%scale.next, %try.next]\n"
+    "    %scaled = fmul double %abs, %scale\n"
+    "    %n.f = call double @llvm.round.f64(double %scaled)\n"
+    "    %fits = fcmp olt double %n.f, 0x4340000000000000\n"
+    "    br i1 %fits, label %try.check, label %slow\n"
+    "try.check:\n"
+    "    %back = fdiv double %n.f, %scale\n"
+    "    %exact = fcmp oeq double %back, %abs\n"
+    "    br i1 %exact, label %print, label %try.next\n"
+    "try.next:\n"
+    "    %d.next = add i64 %d, 1\n"
+    "    %scale.next = fmul double %scale, 10.0\n"
+    "    %more = icmp ult i64 %d.next, 16\n"
+    "    br i1 %more, label %try, label %slow\n"
+    "print:\n"
+    "    %n = fptoui double %n.f to i64\n"
+    "    %n.len = call i64 @wy_fmt_u64(i64 %n, ptr %digits)\n"
+    "    %integer = icmp eq i64 %d, 0\n"
+    "    br i1 %integer, label %print.int, label %print.frac\n"
+    "print.int:\n"
+    "    call void @llvm.memcpy.p0.p0.i64(ptr %out, ptr %digits, i64 %n.len, i1 false)\n"
+    "    %int.len = add i64 %signLen, %n.len\n"
+    "    ret i64 %int.len\n"
+    "print.frac:\n"
+    "    %hasInt = icmp ugt i64 %n.len, %d\n"
+    "    br i1 %hasInt, label %print.point, label %print.zero\n"
+    "print.point:\n"
+    // 12.34
+    "    %intLen = sub i64 %n.len, %d\n"
+    "    call void @llvm.memcpy.p0.p0.i64(ptr %out, ptr %digits, i64 %intLen, i1 false)\n"
+    "    %point = getelementptr inbounds i8, ptr %out, i64 %intLen\n"
+    "    store i8 46, ptr %point\n"
+    "    %frac.dst = getelementptr inbounds i8, ptr %point, i64 1\n"
+    "    %frac.src = getelementptr inbounds i8, ptr %digits, i64 %intLen\n"
+    "    call void @llvm.memcpy.p0.p0.i64(ptr %frac.dst, ptr %frac.src, i64 %d, i1 false)\n"
+    "    %point.len = add i64 %n.len, 1\n"
+    "    %point.total = add i64 %signLen, %point.len\n"
+    "    ret i64 %point.total\n"
+    "print.zero:\n"
+    // 0.0034
+    "    store i8 48, ptr %out\n"
+    "    %zero.point = getelementptr inbounds i8, ptr %out, i64 1\n"
+    "    store i8 46, ptr %zero.point\n"
+    "    %zeros = getelementptr inbounds i8, ptr %out, i64 2\n"
+    "    %zeros.len = sub i64 %d, %n.len\n"
+    "    call void @llvm.memset.p0.i64(ptr %zeros, i8 48, i64 %zeros.len, i1 false)\n"
+    "    %zero.digits = getelementptr inbounds i8, ptr %zeros, i64 %zeros.len\n"
+    "    call void @llvm.memcpy.p0.p0.i64(ptr %zero.digits, ptr %digits, i64 %n.len, i1 false)\n"
+    "    %zero.len = add i64 %d, 2\n"
+    "    %zero.total = add i64 %signLen, %zero.len\n"
+    "    ret i64 %zero.total\n"
+    "slow:\n"
+    "    %p = phi i32 [15, %fast], [15, %try], [15, %try.next], [%p.next, %slow.next]\n"
+    "    %slow.n = call i32 (ptr, i64, ptr, ...) @snprintf(ptr %out, i64 32, ptr @wy.fmt.g, i32 %p, double %abs)\n"
+    "    %parsed = call double @strtod(ptr %out, ptr null)\n"
+    "    %roundTrip = fcmp oeq double %parsed, %abs\n"
+    "    %last = icmp eq i32 %p, 17\n"
+    "    %slow.done = or i1 %roundTrip, %last\n"
+    "    br i1 %slow.done, label %slow.exit, label %slow.next\n"
+    "slow.next:\n"
+    "    %p.next = add i32 %p, 1\n"
+    "    br label %slow\n"
+    "slow.exit:\n"
+    "    %slow.len = sext i32 %slow.n to i64\n"
+    "    %slow.total = add i64 %signLen, %slow.len\n"
+    "    ret i64 %slow.total\n"
+    "}\n"
+    "\n"
+    RUNTIME_PRINT_NUMBER(i32)
+    "\n"
+    RUNTIME_PRINT_NUMBER(i64)
+    "\n"
+    RUNTIME_PRINT_NUMBER(double)
+    "; ---------- wenyan runtime end ----------\n";
@@ -0,0 +1,24 @@
+#ifndef WENYAN_LLVM_RUNTIME_H
+#define WENYAN_LLVM_RUNTIME_H
+
+// Size of the stdout buffer in generated program
+#define RUNTIME_OUTPUT_BUFFER_SIZE 65536
+// Space reserved in the stdout buffer before formatting a number, sign + 32 + newline
+#define RUNTIME_NUMBER_BUFFER_SIZE 40
+
+/**
+ * LLVM IR of the runtime written into every generated module.
+ * Output is collected in a global buffer and written to fd 1 with one write call when full.
+ *
+ * - void @wy_init(): platform setup, must be called at main entry
+ * - void @wy_write(ptr data, i64 size): append bytes to stdout buffer
+ * - void @wy_flush(): write out stdout buffer, must be called before main return
+ * - void @wy_print_i32(i32 value, i1 newLine), @wy_print_i64, @wy_print_double: format number into stdout buffer
+ * - i64 @wy_fmt_i32(i32 value, ptr buf), @wy_fmt_i64, @wy_fmt_double: format number into caller buffer,
+ *   which must have RUNTIME_NUMBER_BUFFER_SIZE bytes, return length written.
+ *   Integers use a digit pair table, double is the shortest decimal that round-trips
+ * - llvm.lifetime.start.p0 / llvm.lifetime.end.p0 are declared here for variable stack slots
+ */
+extern const char runtimeSource[];
+
+#endif //WENYAN_LLVM_RUNTIME_H
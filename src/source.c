@@ -0,0 +1,190 @@
+#include "source.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "compiler_context.h"
+
+// yy_scan_buffer needs 2 end of buffer characters after the text
+#define SOURCE_PADDING 2
+// Recent input kept for diagnostics when text is read from yyin, must cover a flex read ahead
+#define SOURCE_RING_SIZE (64 * 1024)
+
+#define lineStartCount(source) ((source)->lineStarts.len / sizeof(size_t))
+#define lineStartAt(source, i) (((size_t*)(source)->lineStarts.buf)[i])
+
+char* sourceMap(FILE* file, size_t* size) {
+    SourceState* source = &compilerContext->source;
+    struct stat fileStat;
+    if (fstat(fileno(file), &fileStat) || !S_ISREG(fileStat.st_mode) || fileStat.st_size <= 0)
+        return NULL;
+    const size_t fileSize = fileStat.st_size;
+
+#ifdef _WIN32
+    // No mmap, read whole file once instead
+    char* data = malloc(fileSize + SOURCE_PADDING);
+    if (!data) return NULL;
+    const long position = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (fread(data, 1, fileSize, file) != fileSize) {
+        fseek(file, position, SEEK_SET);
+        free(data);
+        return NULL;
+    }
+    fseek(file, position, SEEK_SET);
+    data[fileSize] = data[fileSize + 1] = '\0';
+    // No second mapping, keep a copy
+    source->text = memcpy(malloc(fileSize), data, fileSize);
+    source->mapSize = 0;
+#else
+    const size_t pageSize = sysconf(_SC_PAGESIZE);
+    const size_t mapSize = (fileSize + SOURCE_PADDING + pageSize - 1) / pageSize * pageSize;
+
+    // Reserve zero pages, then map file over the front. Rest of last file page reads as zero,
+    // and if file ends at page boundary the next reserved page is the sentinel
+    char* data = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED)
+        return NULL;
+    if (mmap(data, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fileno(file), 0) == MAP_FAILED) {
+        munmap(data, mapSize);
+        return NULL;
+    }
+    // Read only view shares the page cache with the copy on write mapping
+    char* text = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    if (text == MAP_FAILED) {
+        munmap(data, mapSize);
+        return NULL;
+    }
+    source->text = text;
+    source->mapSize = mapSize;
+#endif
+
+    source->data = data;
+    source->size = fileSize;
+    *size = fileSize;
+    return data;
+}
+
+char* sourceCopy(const char* text, const size_t size) {
+    SourceState* source = &compilerContext->source;
+    char* data = malloc(size + SOURCE_PADDING);
+    memcpy(data, text, size);
+    data[size] = data[size + 1] = '\0';
+
+    source->data = data;
+    source->text = (char*)text;
+    source->size = size;
+    source->copied = true;
+    return data;
+}
+
+bool sourceContains(const char* ptr) {
+    const SourceState* source = &compilerContext->source;
+    return source->data && (uintptr_t)ptr >= (uintptr_t)source->data &&
+        (uintptr_t)ptr < (uintptr_t)(source->data + source->size + SOURCE_PADDING);
+}
+
+size_t sourceRead(FILE* file, char* buf, const size_t maxSize, const bool interactive) {
+    SourceState* source = &compilerContext->source;
+    size_t len = 0;
+    if (interactive) {
+        // Stop at line end, like flex default input, so a terminal is not waited on
+        int c;
+        while (len < maxSize && (c = getc(file)) != EOF) {
+            buf[len++] = (char)c;
+            if (c == '\n') break;
+        }
+    } else
+        len = fread(buf, 1, maxSize, file);
+
+    for (size_t i = 0; i < len; ++i) {
+        if (buf[i] == '\n') {
+            const size_t start = source->readSize + i + 1;
+            byteBufferWrite(&source->lineStarts, (uint8_t*)&start, sizeof(size_t));
+        }
+    }
+    // Copy the tail into ring
+    if (!source->ring)
+        source->ring = malloc(SOURCE_RING_SIZE);
+    const size_t keep = len < SOURCE_RING_SIZE ? len : SOURCE_RING_SIZE;
+    const size_t from = source->readSize + len - keep;
+    const size_t pos = from % SOURCE_RING_SIZE, first = keep < SOURCE_RING_SIZE - pos ? keep : SOURCE_RING_SIZE - pos;
+    memcpy(source->ring + pos, buf + len - keep, first);
+    memcpy(source->ring, buf + len - keep + first, keep - first);
+    source->readSize += len;
+    return len;
+}
+
+static void indexSourceLines(SourceState* source, const int line) {
+    // Index one line past the requested one, its start is where the line ends
+    while (lineStartCount(source) < (size_t)line && source->indexedSize < source->size) {
+        const char* newLine = memchr(source->text + source->indexedSize, '\n', source->size - source->indexedSize);
+        if (!newLine) {
+            source->indexedSize = source->size;
+            break;
+        }
+        source->indexedSize = newLine - source->text + 1;
+        byteBufferWrite(&source->lineStarts, (uint8_t*)&source->indexedSize, sizeof(size_t));
+    }
+}
+
+bool sourceLine(const int line, char* buf, const size_t size) {
+    SourceState* source = &compilerContext->source;
+    if (line < 1 || size == 0)
+        return true;
+    if (source->text)
+        indexSourceLines(source, line);
+    if ((size_t)line > lineStartCount(source) + 1)
+        return true;
+
+    const size_t available = source->text ? source->size : source->readSize;
+    const size_t start = line == 1 ? 0 : lineStartAt(source, line - 2);
+    const size_t end = (size_t)line <= lineStartCount(source) ? lineStartAt(source, line - 1) : available;
+    // Not read yet, or already dropped from ring
+    if (start >= available || (!source->text && start + SOURCE_RING_SIZE < source->readSize))
+        return true;
+
+    size_t len = end - start;
+    if (len > size - 1) len = size - 1;
+    if (source->text)
+        memcpy(buf, source->text + start, len);
+    else {
+        const size_t pos = start % SOURCE_RING_SIZE, first = len < SOURCE_RING_SIZE - pos ? len : SOURCE_RING_SIZE - pos;
+        memcpy(buf, source->ring + pos, first);
+        memcpy(buf + first, source->ring, len - first);
+    }
+    buf[len] = '\0';
+    return false;
+}
+
+void sourceUnmap() {
+    SourceState* source = &compilerContext->source;
+    byteBufferFree(&source->lineStarts, false);
+    free(source->ring);
+    source->ring = NULL;
+    source->indexedSize = source->readSize = 0;
+    if (!source->data) return;
+    if (source->copied)
+        free(source->data);
+    else {
+#ifdef _WIN32
+        free(source->data);
+        free(source->text);
+#else
+        munmap(source->data, source->mapSize);
+        munmap(source->text, source->size);
+#endif
+    }
+    source->data = source->text = NULL;
+    source->copied = false;
+    source->size = source->mapSize = 0;
+}
@@ -0,0 +1,62 @@
+#ifndef WENYAN_LLVM_SOURCE_H
+#define WENYAN_LLVM_SOURCE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "lib/byte_buffer.h"
+
+/** Input of one compilation, in CompilerContext */
+typedef struct {
+    char* data;
+    // Unmodified view of mapped source, scanner terminates tokens inside data
+    char* text;
+    size_t size;
+    size_t mapSize;
+    // data is a padded copy of caller text from sourceCopy
+    bool copied;
+
+    // Start offset of each line after the first, lineStartAt(i) is line i + 2
+    ByteBuffer lineStarts;
+    // Mapped source bytes already indexed
+    size_t indexedSize;
+
+    // Recent input kept for diagnostics when text is read from yyin, allocated at first read
+    char* ring;
+    // Total bytes read from yyin
+    size_t readSize;
+} SourceState;
+
+/**
+ * Map the whole input file into memory, followed by at least 2 '\0' required by yy_scan_buffer.
+ * Mapping is private and writable, scanner and string literal tokens use the text in place.
+ * @param file regular file opened for reading
+ * @param size output, source text size without padding
+ * @return mapped text, NULL if file can't be mapped
+ */
+char* sourceMap(FILE* file, size_t* size);
+/**
+ * Copy source text in memory for scanning in place, followed by 2 '\0' like sourceMap
+ * @param text kept as the unmodified view until sourceUnmap, owned by caller
+ * @return padded copy
+ */
+char* sourceCopy(const char* text, size_t size);
+/** Whether ptr points into the mapped source, such text is not owned by the token */
+bool sourceContains(const char* ptr);
+/**
+ * Read input for the scanner when source is not mapped, line starts and recent text are kept
+ * so diagnostics work on pipes and stdin
+ * @param interactive stop after a newline instead of filling buf
+ * @return bytes read, 0 at end of input
+ */
+size_t sourceRead(FILE* file, char* buf, size_t maxSize, bool interactive);
+/**
+ * Copy a source line with its newline into buf, truncated to size - 1 bytes
+ * @param line 1-based line number
+ * @return true if the line is not read yet or no longer kept
+ */
+bool sourceLine(int line, char* buf, size_t size);
+/** Unmap source and drop the line index */
+void sourceUnmap();
+
+#endif //WENYAN_LLVM_SOURCE_H
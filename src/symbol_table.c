@@ -0,0 +1,102 @@
+#include "symbol_table.h"
+
+#include <stdlib.h>
+
+#include "compiler_context.h"
+#include "intern.h"
+#include "lib/byte_buffer.h"
+
+#define SYMBOL_TABLE_INIT_SLOTS 64
+
+typedef struct SymbolEntry {
+    SymbolData data;
+    // Symbol of the same name in outer scope
+    struct SymbolEntry* shadowed;
+} SymbolEntry;
+
+struct SymbolSlot {
+    // Interned name, NULL if slot is empty
+    const char* name;
+    // Innermost visible symbol, NULL after its scope is popped
+    SymbolEntry* top;
+};
+
+#define entryAt(table, index) (((SymbolEntry**)(table)->declared.buf)[index])
+#define declaredCount(table) ((table)->declared.len / sizeof(SymbolEntry*))
+
+static SymbolSlot* findSlot(SymbolSlot* table, const size_t tableSize, const char* name) {
+    size_t slot = intern_hash(name) & (tableSize - 1);
+    while (table[slot].name && table[slot].name != name)
+        slot = (slot + 1) & (tableSize - 1);
+    return &table[slot];
+}
+
+static void growSlots(SymbolTable* table) {
+    const size_t newSlotCount = table->slotCount ? table->slotCount * 2 : SYMBOL_TABLE_INIT_SLOTS;
+    SymbolSlot* newSlots = calloc(newSlotCount, sizeof(SymbolSlot));
+    for (size_t i = 0; i < table->slotCount; ++i) {
+        if (table->slots[i].name)
+            *findSlot(newSlots, newSlotCount, table->slots[i].name) = table->slots[i];
+    }
+    free(table->slots);
+    table->slots = newSlots;
+    table->slotCount = newSlotCount;
+}
+
+void symbolTable_pushScope() {
+    SymbolTable* table = &compilerContext->symbolTable;
+    const size_t watermark = declaredCount(table);
+    byteBufferWrite(&table->watermarks, (uint8_t*)&watermark, sizeof(size_t));
+}
+
+void symbolTable_popScope(void (*onEnd)(const SymbolData* symbol)) {
+    SymbolTable* table = &compilerContext->symbolTable;
+    table->watermarks.len -= sizeof(size_t);
+    const size_t watermark = *(size_t*)(table->watermarks.buf + table->watermarks.len);
+
+    if (onEnd) {
+        for (size_t i = watermark; i < declaredCount(table); ++i)
+            onEnd(&entryAt(table, i)->data);
+    }
+    // Undo newest first, so each slot goes back to the symbol it shadowed
+    for (size_t i = declaredCount(table); i > watermark; --i) {
+        const SymbolEntry* entry = entryAt(table, i - 1);
+        findSlot(table->slots, table->slotCount, entry->data.name)->top = entry->shadowed;
+    }
+    table->declared.len = watermark * sizeof(SymbolEntry*);
+}
+
+SymbolData* symbolTable_add(const SymbolData* symbol) {
+    SymbolTable* table = &compilerContext->symbolTable;
+    // Keep load factor under half, slots of popped names are kept for reuse
+    if ((table->nameCount + 1) * 2 > table->slotCount)
+        growSlots(table);
+
+    SymbolSlot* slot = findSlot(table->slots, table->slotCount, symbol->name);
+    if (!slot->name) {
+        slot->name = symbol->name;
+        ++table->nameCount;
+    }
+
+    SymbolEntry* entry = arenaNew(&compilerContext->frontendArena, SymbolEntry);
+    *entry = (SymbolEntry){*symbol, slot->top};
+    slot->top = entry;
+    byteBufferWrite(&table->declared, (uint8_t*)&entry, sizeof(SymbolEntry*));
+    return &entry->data;
+}
+
+SymbolData* symbolTable_find(const char* name) {
+    const SymbolTable* table = &compilerContext->symbolTable;
+    if (!table->slotCount)
+        return NULL;
+    const SymbolSlot* slot = findSlot(table->slots, table->slotCount, name);
+    return slot->top ? &slot->top->data : NULL;
+}
+
+void symbolTable_free() {
+    SymbolTable* table = &compilerContext->symbolTable;
+    byteBufferFree(&table->declared, false);
+    byteBufferFree(&table->watermarks, false);
+    free(table->slots);
+    *table = (SymbolTable){NULL, 0, 0, byteBufferInit(), byteBufferInit()};
+}
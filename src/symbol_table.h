@@ -0,0 +1,45 @@
+#ifndef WENYAN_LLVM_SYMBOL_TABLE_H
+#define WENYAN_LLVM_SYMBOL_TABLE_H
+
+#include "object.h"
+#include "lib/byte_buffer.h"
+
+/*
+ * Scoped symbol table, one open addressing table for all scopes keyed by interned name.
+ * Each name slot holds the innermost visible symbol, which links to the one it shadows.
+ * Pushing a scope records a watermark of declared symbols, popping undoes back to it.
+ * Table belongs to the current compilerContext.
+ */
+
+typedef struct SymbolSlot SymbolSlot;
+
+typedef struct {
+    SymbolSlot* slots;
+    size_t slotCount;
+    size_t nameCount;
+    /** SymbolEntry*[], declared symbols of all open scopes in declaration order */
+    ByteBuffer declared;
+    /** size_t[], count of declared symbols when each open scope is pushed */
+    ByteBuffer watermarks;
+} SymbolTable;
+
+void symbolTable_pushScope();
+/**
+ * Remove symbols declared in the innermost scope
+ * @param onEnd called for each removed symbol in declaration order, can be NULL
+ */
+void symbolTable_popScope(void (*onEnd)(const SymbolData* symbol));
+/**
+ * Declare symbol in the innermost scope, shadowing the same name of outer scope
+ * @param symbol copied into frontendArena, name must be interned
+ * @return symbol stored in the table, valid until its scope is popped
+ */
+SymbolData* symbolTable_add(const SymbolData* symbol);
+/**
+ * @param name interned name
+ * @return innermost visible symbol, NULL if not declared
+ */
+SymbolData* symbolTable_find(const char* name);
+void symbolTable_free();
+
+#endif //WENYAN_LLVM_SYMBOL_TABLE_H
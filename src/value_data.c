@@ -4,11 +4,26 @@
 
 #include "value_data.h"
 
+#include <stdlib.h>
+
 #include "compiler_util.h"
 
-bool object_ValueDataListCreate(const ObjectType valueType, ValueData* valueData) {
-    linkedList_init(&valueData->valueList);
-    valueData->valueType = valueType;
+bool object_ValueDataListCreate(const ObjectType valueType, ValueData** valueData) {
+    ValueDataPool* pool = &compilerContext->valueData;
+    ValueData* data = pool->freeList;
+    if (data)
+        pool->freeList = data->nextFree;
+    else {
+        data = malloc(sizeof(ValueData));
+        data->values = data->inlineValues;
+        data->capacity = VALUE_DATA_INLINE_COUNT;
+        data->nextAlloc = pool->allocList;
+        pool->allocList = data;
+    }
+    data->valueType = valueType;
+    data->count = data->popCount = 0;
+    data->nextFree = NULL;
+    *valueData = data;
     return false;
 }
 
@@ -25,21 +40,42 @@ bool object_ValueDataListAdd(ValueData* valueData, const Object* obj) {
         return true;
     }
 
-    linkedList_addp(&valueData->valueList, false, cloneStruct(Object, obj));
+    if (valueData->count == valueData->capacity) {
+        const uint32_t capacity = valueData->capacity * 2;
+        if (valueData->values == valueData->inlineValues) {
+            valueData->values = malloc(capacity * sizeof(Object));
+            memcpy(valueData->values, valueData->inlineValues, valueData->count * sizeof(Object));
+        } else
+            valueData->values = realloc(valueData->values, capacity * sizeof(Object));
+        valueData->capacity = capacity;
+    }
+    valueData->values[valueData->count++] = *obj;
     return false;
 }
 
 Object* object_ValueDataListPop(ValueData* valueData) {
-    if (valueData->valueList.length == 0)
+    if (valueData->popCount == valueData->count)
         return NULL;
-    
-    LinkedListNode* firstNode = valueData->valueList.head->next;
-    Object* obj = firstNode->value;
-    linkedList_deleteNode(&valueData->valueList, firstNode);
-    return obj;
+    return &valueData->values[valueData->popCount++];
 }
 
 bool object_ValueDataListFree(ValueData* valueData) {
-    linkedList_freeA(&valueData->valueList, free);
+    // Keep grown array for the next declaration
+    valueData->count = valueData->popCount = 0;
+    ValueDataPool* pool = &compilerContext->valueData;
+    valueData->nextFree = pool->freeList;
+    pool->freeList = valueData;
     return false;
 }
+
+void object_ValueDataFreeAll() {
+    ValueDataPool* pool = &compilerContext->valueData;
+    while (pool->allocList) {
+        ValueData* next = pool->allocList->nextAlloc;
+        if (pool->allocList->values != pool->allocList->inlineValues)
+            free(pool->allocList->values);
+        free(pool->allocList);
+        pool->allocList = next;
+    }
+    pool->freeList = NULL;
+}
@@ -7,26 +7,41 @@
 
 
 #include "object.h"
-#include "WJCL/list/wjcl_linked_list.h"
+
+#define VALUE_DATA_INLINE_COUNT 4
 
 /**
- * For single or multiple variable declaration
+ * For single or multiple variable declaration, values are kept in place up to VALUE_DATA_INLINE_COUNT.
+ * Parser holds it by pointer, freed ValueData is reused by the next declaration
  */
-typedef struct {
-    /** LinkedList<@link Object> */
-    LinkedList valueList;
+typedef struct ValueData {
     ObjectType valueType;
+    uint32_t count;
+    // Values already taken by object_ValueDataListPop
+    uint32_t popCount;
+    uint32_t capacity;
+    // inlineValues, or heap array after outgrowing it
+    Object* values;
+    // Next in free list
+    struct ValueData* nextFree;
+    // Next allocated, for object_ValueDataFreeAll
+    struct ValueData* nextAlloc;
+    Object inlineValues[VALUE_DATA_INLINE_COUNT];
 } ValueData;
 
+/** ValueData of one compilation, in CompilerContext */
+typedef struct {
+    ValueData* freeList;
+    ValueData* allocList;
+} ValueDataPool;
 
 /**
  * Create init ValueData
  * @param valueType
- * @param valueType
  * @param valueData ValueData* output
  * @return false if success
  */
-bool object_ValueDataListCreate(ObjectType valueType, ValueData* valueData);
+bool object_ValueDataListCreate(ObjectType valueType, ValueData** valueData);
 /**
  * Add Value to ValueData
  * @param valueData ValueData*
@@ -38,11 +53,14 @@ bool object_ValueDataListAdd(ValueData* valueData, const Object* obj);
 /** 
  * Pop Value in ValueData
  * @param valueData ValueData*
- * @return Object*
+ * @return Object*, valid until ValueData is freed
  */
 Object* object_ValueDataListPop(ValueData* valueData);
 
+/** Give ValueData back for reuse */
 bool object_ValueDataListFree(ValueData* valueData);
+/** Free every ValueData, including ones still held by the parser */
+void object_ValueDataFreeAll();
 
 #endif //WENYAN_LLVM_VALUE_DATA_H
 
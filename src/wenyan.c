@@ -0,0 +1,36 @@
+#include "wenyan.h"
+
+#include <stdlib.h>
+
+#include "codegen.h"
+#include "compiler_util.h"
+#include "source.h"
+
+bool wenyan_compile(const char* source, const size_t size, const WenyanOptions* options, ByteBuffer* out,
+                    ByteBuffer* diagnostics) {
+    static const WenyanOptions defaultOptions = {0};
+    CompilerContext ctx;
+    bool failed = true;
+    if (compilerContext_init(&ctx, options ? options : &defaultOptions)) {
+        ctx.diagnostics = diagnostics;
+        reportFailuref("cannot create scanner\n");
+    } else {
+        ctx.inputFilePath = ctx.inputFileName = ctx.options.fileName;
+        ctx.diagnostics = diagnostics;
+
+        // Scan a padded copy in place, error lines are read from caller text
+        yyScanSource(ctx.scanner, sourceCopy(source, size), size);
+        failed = compilerContext_compile(&ctx) || codegen_write(out, NULL, ctx.options.emitBitcode);
+    }
+
+    compilerContext_free(&ctx);
+    return failed;
+}
+
+void wenyan_diagnosticsFree(ByteBuffer* diagnostics) {
+    for (size_t i = 0; i < wenyanDiagnosticCount(diagnostics); ++i)
+        free(wenyanDiagnosticAt(diagnostics, i).message);
+    byteBufferFree(diagnostics, false);
+    // Empty and ready for the next compile
+    *diagnostics = (ByteBuffer)byteBufferInit();
+}
@@ -0,0 +1,56 @@
+#ifndef WENYAN_LLVM_WENYAN_H
+#define WENYAN_LLVM_WENYAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "lib/byte_buffer.h"
+
+/*
+ * In memory compile API of the wenyan library, the command line compiler is built on it.
+ * Each call has its own state, different threads may compile at the same time.
+ */
+
+typedef struct {
+    // Module name in the output, NULL for none
+    const char* fileName;
+    // 0 to 3, same as -O of clang, requires WENYAN_USE_LLVM build above 0
+    int optLevel;
+    // Write LLVM bitcode instead of textual IR, requires WENYAN_USE_LLVM build
+    bool emitBitcode;
+    // Generated program flushes stdout after every printed line
+    bool lineBuffered;
+    // Add unroll and vectorize hints to loop metadata
+    bool loopHints;
+    // Share storage of string constants that end with another one
+    bool mergeStrings;
+    // Keep memory bounded on large programs, text backend moves generated code out to a temporary file
+    bool stream;
+} WenyanOptions;
+
+typedef struct {
+    // 1-based line and UTF-8 column of the token, 0 if not tied to source
+    int line;
+    int column;
+    // Message without location, owned by the diagnostics buffer
+    char* message;
+} WenyanDiagnostic;
+
+#define wenyanDiagnosticCount(diagnostics) ((diagnostics)->len / sizeof(WenyanDiagnostic))
+#define wenyanDiagnosticAt(diagnostics, i) (((WenyanDiagnostic*)(diagnostics)->buf)[i])
+
+/**
+ * Compile wenyan source in memory on the calling thread
+ * @param source UTF-8 text, doesn't need to be terminated
+ * @param options NULL for defaults
+ * @param out generated module is appended, only written if compile succeeded
+ * @param diagnostics WenyanDiagnostic[] appended, free with wenyan_diagnosticsFree.
+ *                    NULL to print them to stderr like the command line compiler
+ * @return true if failed
+ */
+bool wenyan_compile(const char* source, size_t size, const WenyanOptions* options, ByteBuffer* out,
+                    ByteBuffer* diagnostics);
+/** Free messages and storage of diagnostics, leaving it empty */
+void wenyan_diagnosticsFree(ByteBuffer* diagnostics);
+
+#endif //WENYAN_LLVM_WENYAN_H